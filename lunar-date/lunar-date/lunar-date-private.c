@@ -19,6 +19,7 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  * */
 
+#include <string.h>
 #include <lunar-date/lunar-date.h>
 #include "lunar-date-private.h"
 #include <glib/gi18n-lib.h>
@@ -35,13 +36,23 @@ gint _cmp_date (gint month1, gint day1, gint month2, gint day2)
 	return(0);
 }
 
+/* 节气名称, 以小寒为第0个. */
+static const char* solar_term_name[] = {
+	N_("Xi\307\216oh\303\241n"), N_("D\303\240h\303\241n"), N_("L\303\254ch\305\253n"), N_("Y\307\224shu\307\220"),
+	N_("J\304\253ngzh\303\251"), N_("Ch\305\253nf\304\223n"), N_("Q\304\253ngm\303\255ng"), N_("G\307\224y\307\224"), 
+	N_("L\303\254xi\303\240"), N_("Xi\307\216om\307\216n"), N_("M\303\241ngzh\303\262ng"), N_("Xi\303\240zh\303\254"), 
+	N_("Xi\307\216osh\307\224"), N_("D\303\240sh\307\224"), N_("L\303\254q\304\253u"), N_("Ch\303\271sh\307\224"), 
+	N_("B\303\241il\303\262u"), N_("Q\304\253uf\304\223n"), N_("H\303\241nl\303\262u"), N_("Shu\304\201ngji\303\240ng"), 
+	N_("L\303\254d\305\215ng"), N_("Xi\307\216oxu\304\233"), N_("D\303\240xu\304\233"), N_("D\305\215ngzh\303\254") 
+};
+
 /**
- * year_jieqi:
+ * _solar_term_date:
  *
- * 传回 year 年第 n 个节气的日期(公历).
+ * 传回 year 年第 n 个节气的日期(公历), 存入 *ry, *rm, *rd.
  * 以小寒为第0个节气. 1900-2100年应该没问题.
  **/
-void year_jieqi(int year, int n, char* result)
+void _solar_term_date(gint year, gint n, gint *ry, gint *rm, gint *rd)
 {
 
 	/* 1900/1/6 02:05:00 小寒  */
@@ -52,14 +63,6 @@ void year_jieqi(int year, int n, char* result)
 			263343,285989,308563,331033,353350,375494,
 			397447,419210,440795,462224,483532,504758
 	};
-	static const char* solar_term_name[] = {
-		N_("Xi\307\216oh\303\241n"), N_("D\303\240h\303\241n"), N_("L\303\254ch\305\253n"), N_("Y\307\224shu\307\220"),
-		N_("J\304\253ngzh\303\251"), N_("Ch\305\253nf\304\223n"), N_("Q\304\253ngm\303\255ng"), N_("G\307\224y\307\224"), 
-		N_("L\303\254xi\303\240"), N_("Xi\307\216om\307\216n"), N_("M\303\241ngzh\303\262ng"), N_("Xi\303\240zh\303\254"), 
-		N_("Xi\307\216osh\307\224"), N_("D\303\240sh\307\224"), N_("L\303\254q\304\253u"), N_("Ch\303\271sh\307\224"), 
-		N_("B\303\241il\303\262u"), N_("Q\304\253uf\304\223n"), N_("H\303\241nl\303\262u"), N_("Shu\304\201ngji\303\240ng"), 
-		N_("L\303\254d\305\215ng"), N_("Xi\307\216oxu\304\233"), N_("D\303\240xu\304\233"), N_("D\305\215ngzh\303\254") 
-	};
 	static const int mdays[] = {0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334, 365};
 
 	int y, m, d, diff;
@@ -113,8 +116,257 @@ void year_jieqi(int year, int n, char* result)
 		}
 	}	 
 
-	g_sprintf(result, "%04d%02d%02d %s", y, m, d, _(solar_term_name[n]));
-	result = NULL;
+	*ry = y;
+	*rm = m;
+	*rd = d;
+}
+
+/**
+ * _solar_term_name:
+ *
+ * 传回第 n 个节气的名称, 已翻译.
+ **/
+const gchar* _solar_term_name(gint n)
+{
+	return _(solar_term_name[n]);
+}
+
+/**
+ * year_jieqi:
+ *
+ * 传回 year 年第 n 个节气的日期(公历).
+ * 以小寒为第0个节气. 1900-2100年应该没问题.
+ **/
+void year_jieqi(int year, int n, char* result)
+{
+	gint y, m, d;
+
+	_solar_term_date(year, n, &y, &m, &d);
+	g_sprintf(result, "%04d%02d%02d %s", y, m, d, _solar_term_name(n));
+}
+
+/* Days of each lunar year and the day number of its first day. */
+guint	_lunar_year_days[NUM_OF_YEARS];
+glong	_lunar_year_start[NUM_OF_YEARS + 1];
+/*
+ * The day number of the first day of each lunar month, the months of
+ * all the years in a row, and the place of the first month of each
+ * year in it.  The place of a month is its ordinal.
+ */
+glong	_lunar_month_start[MAX_LUNAR_MONTHS + 1];
+guint16	_lunar_year_month[NUM_OF_YEARS + 1];
+
+/**
+ * _lunar_tables_init:
+ *
+ * Builds the lunar year and month tables, once per process.
+ **/
+void _lunar_tables_init (void)
+{
+	static gsize initialized = 0;
+	guint month_days[NUM_OF_MONTHS + 1];
+	gint year, i, leap, n;
+	long code;
+
+	if (!g_once_init_enter(&initialized))
+		return;
+
+	for (year = 0; year < NUM_OF_YEARS; year++)
+	{
+		code = years_info[year];
+		leap = code & 0xf;
+		_lunar_year_days[year] = 0;
+		if (leap != 0)
+		{
+			i = (code >> 16) & 0x1;
+			_lunar_year_days[year] += days_in_lunar_month[i];
+		}
+		code >>= 4;
+		for (i = 0; i < NUM_OF_MONTHS-1; i++)
+		{
+			_lunar_year_days[year] += days_in_lunar_month[code&0x1];
+			code >>= 1;
+		}
+		_lunar_year_start[year + 1] = _lunar_year_start[year] + _lunar_year_days[year];
+	}
+
+	for (year = 0, n = 0; year < NUM_OF_YEARS; year++)
+	{
+		_lunar_year_month[year] = n;
+		leap = _lunar_make_month_days(year, month_days);
+		for (i = 1; i <= (leap ? NUM_OF_MONTHS : NUM_OF_MONTHS - 1); i++, n++)
+			_lunar_month_start[n + 1] = _lunar_month_start[n] + month_days[i];
+	}
+	_lunar_year_month[NUM_OF_YEARS] = n;
+	g_once_init_leave(&initialized, 1);
+}
+
+/**
+ * _lunar_make_month_days:
+ * @year: the year, counted from BEGIN_YEAR
+ * @month_days: the days of each month, in the order of the year
+ *
+ * Compute the days of each month in the given lunar year.
+ *
+ * Return value: the leap month, 0 if none.
+ **/
+gint _lunar_make_month_days (gint year, guint *month_days)
+{
+	int i, leap_month;
+	long code;
+
+	code = years_info[year];
+	leap_month = code & 0xf;
+	code >>= 4;
+	if (leap_month == 0)
+	{
+		month_days[NUM_OF_MONTHS] = 0;
+		for (i = NUM_OF_MONTHS-1; i >= 1; i--)
+		{
+			month_days[i] = days_in_lunar_month[code&0x1];
+			code >>= 1;
+		}
+	}
+	else
+	{
+		/* 
+		   There is a leap month (run4 yue4) L in this year.
+		   mday[1] contains the number of days in the 1-st month;
+		   mday[L] contains the number of days in the L-th month;
+		   mday[L+1] contains the number of days in the L-th leap month;
+		   mday[L+2] contains the number of days in the L+1 month, etc.
+
+		   cf. years_info[]: info about the leap month is encoded differently.
+		   */
+		i = (years_info[year] >> 16) & 0x1;
+		month_days[leap_month+1] = days_in_lunar_month[i];
+		for (i = NUM_OF_MONTHS; i >= 1; i--)
+		{
+			if (i == leap_month+1) 
+				i--;
+			month_days[i] = days_in_lunar_month[code&0x1];
+			code >>= 1;
+		}
+	}
+	return leap_month;
+}
+
+/**
+ * _lunar_to_days:
+ *
+ * Compute the day number, counted from BEGIN_YEAR.1.1 of the lunar
+ * calendar, of a lunar date.  The year must be in the table.
+ *
+ * Return value: the day number, or -1 with @error set.
+ **/
+glong _lunar_to_days (gint year, gint month, gint day, gboolean isleap, GError **error)
+{
+	gint ordinal;
+
+	ordinal = _lunar_month_ordinal(year, month, isleap);
+	if (ordinal < 0)
+	{
+		g_set_error(error, LUNAR_DATE_ERROR,
+				LUNAR_DATE_ERROR_LEAP,
+				_("%d is not a leap month in year %d.\n"), 
+				month, year);
+		return -1;
+	}
+	if (day > _lunar_month_days(ordinal)) 
+	{
+		g_set_error(error, LUNAR_DATE_ERROR,
+				LUNAR_DATE_ERROR_DAY,
+				_("Day out of range: \"%d\""),
+				day);
+		return -1;
+	}
+	return _lunar_month_start[ordinal] + day - 1;
+}
+
+/**
+ * _lunar_month_ordinal:
+ *
+ * The place of a lunar month in _lunar_month_start[], the year must be
+ * in the table.
+ *
+ * Return value: the ordinal, or -1 if @isleap and @month is not the
+ * leap month of @year.
+ **/
+gint _lunar_month_ordinal (gint year, gint month, gboolean isleap)
+{
+	gint y, leap_month;
+
+	y = year - BEGIN_YEAR;
+	leap_month = years_info[y] & 0xf;
+	if (isleap && leap_month != month)
+		return -1;
+	if (leap_month != 0 && (month > leap_month || isleap))
+		month++;
+	return _lunar_year_month[y] + month - 1;
+}
+
+/**
+ * _lunar_month_from_ordinal:
+ *
+ * The lunar month at @ordinal of _lunar_month_start[].
+ **/
+void _lunar_month_from_ordinal (gint ordinal, gint *year, gint *month, gboolean *isleap)
+{
+	gint y, m, leap_month;
+
+	/* 7 years of 19 have 13 months, the guess is off by a year at most */
+	y = MIN((gint) ((gint64) ordinal * 19 / 235), NUM_OF_YEARS - 1);
+	while (_lunar_year_month[y] > ordinal)
+		y--;
+	while (_lunar_year_month[y + 1] <= ordinal)
+		y++;
+	m = ordinal - _lunar_year_month[y] + 1;
+	leap_month = years_info[y] & 0xf;
+
+	*year = y + BEGIN_YEAR;
+	*isleap = leap_month != 0 && m == leap_month + 1;
+	*month = (leap_month != 0 && m > leap_month) ? m - 1 : m;
+}
+
+/**
+ * _lunar_month_find:
+ *
+ * The ordinal of the lunar month day number @days falls in, which must
+ * be in the table.
+ **/
+gint _lunar_month_find (glong days)
+{
+	gint ordinal;
+
+	/* the months are 29 or 30 days and never stray more than a month
+	 * from their mean length of 29.530589 days */
+	ordinal = (gint) ((gint64) days * 1000000 / 29530589);
+	ordinal = MIN(ordinal, _lunar_year_month[NUM_OF_YEARS] - 1);
+	while (_lunar_month_start[ordinal] > days)
+		ordinal--;
+	while (_lunar_month_start[ordinal + 1] <= days)
+		ordinal++;
+	return ordinal;
+}
+
+/**
+ * _lunar_from_days:
+ *
+ * The lunar date of a day number, see _lunar_to_days().
+ *
+ * Return value: %FALSE if the day is out of the table.
+ **/
+gboolean _lunar_from_days (glong days, gint *year, gint *month, gint *day, gboolean *isleap)
+{
+	gint ordinal;
+
+	if (days < 0 || days >= _lunar_year_start[NUM_OF_YEARS])
+		return FALSE;
+
+	ordinal = _lunar_month_find(days);
+	_lunar_month_from_ordinal(ordinal, year, month, isleap);
+	*day = days - _lunar_month_start[ordinal] + 1;
+	return TRUE;
 }
 
 /* Compute the number of days from the Solar date BYEAR.1.1 */
@@ -236,53 +488,126 @@ mymemcnt(const char *mem, int len, const char *pat, int pat_len)
 	return nfound;
 }
 
-/* 1982/34 -> 一九八二/三四 */
-void num_2_hanzi(int n, char* hanzi, gulong len)
+/*
+ * Translated numerals, built once per message catalog.
+ *
+ * The translation of hanzi_num[10] identifies the catalog: gettext hands
+ * back the same pointer for as long as the catalog stays loaded, so a
+ * locale switch simply adds another table to the list.  Tables are never
+ * freed and only prepended, readers walk the list without a lock.
+ */
+typedef struct _HanziNumerals HanziNumerals;
+
+struct _HanziNumerals
+{
+	const gchar   *key;
+	const gchar   *digit[10];
+	gsize		   digit_len[10];
+	gchar		  *mday[32];
+	gsize		   mday_len[32];
+	HanziNumerals *next;
+};
+
+G_LOCK_DEFINE_STATIC (hanzi_numerals);
+static HanziNumerals *hanzi_numerals_list = NULL;
+
+/* 0 -> 〇, 1..9 -> 一..九, 10 -> 十, 11..19 -> 十一..十九, 20 -> 二十, 21 -> 二十一 */
+static gchar* _hanzi_mday_new(const gchar **digit, const gchar *ten, int n)
+{
+	if (n < 10)
+		return g_strdup(digit[n]);
+	if (n == 10)
+		return g_strdup(ten);
+	if (n < 20)
+		return g_strconcat(ten, digit[n % 10], NULL);
+	if ((n % 10) == 0)
+		return g_strconcat(digit[n / 10], ten, NULL);
+	return g_strconcat(digit[n / 10], ten, digit[n % 10], NULL);
+}
+
+static const HanziNumerals* _hanzi_numerals_get(void)
 {
-	GString *str = g_string_new("");
-	int d;
-	while (n > 10)
+	HanziNumerals *table;
+	const gchar *key;
+	int i;
+
+	key = _(hanzi_num[10]);
+	for (table = g_atomic_pointer_get(&hanzi_numerals_list); table != NULL; table = table->next)
+		if (table->key == key)
+			return table;
+
+	G_LOCK (hanzi_numerals);
+	for (table = hanzi_numerals_list; table != NULL; table = table->next)
+		if (table->key == key)
+			break;
+	if (table == NULL)
 	{
-		d = n % 10;
-		n = n/10;
-		str = g_string_prepend(str, _(hanzi_num[d]));
+		table = g_new0(HanziNumerals, 1);
+		table->key = key;
+		for (i = 0; i < 10; i++)
+		{
+			table->digit[i] = _(hanzi_num[i]);
+			table->digit_len[i] = strlen(table->digit[i]);
+		}
+		for (i = 0; i < 32; i++)
+		{
+			table->mday[i] = _hanzi_mday_new(table->digit, key, i);
+			table->mday_len[i] = strlen(table->mday[i]);
+		}
+		table->next = hanzi_numerals_list;
+		g_atomic_pointer_set(&hanzi_numerals_list, table);
 	}
-	str = g_string_prepend(str, _(hanzi_num[n]));
+	G_UNLOCK (hanzi_numerals);
+	return table;
+}
 
-	g_snprintf(hanzi, len, "%s", str->str);
-	g_string_free(str, TRUE);
+static void _hanzi_copy(char* hanzi, gulong len, gulong *pos, const gchar *str, gsize n)
+{
+	if (*pos + n >= len)
+		n = (*pos < len) ? len - 1 - *pos : 0;
+	memcpy(hanzi + *pos, str, n);
+	*pos += n;
 }
 
-void mday_2_hanzi(int n, char* hanzi, gulong len)
+/* 1982/34 -> 一九八二/三四 */
+void num_2_hanzi(int n, char* hanzi, gulong len)
 {
-	GString *str = g_string_new("");
-	int d;
+	const HanziNumerals *table;
+	int digits[12];
+	int i = 0;
+	gulong pos = 0;
 
-	if ((n % 10) == 0)
+	if (len == 0)
+		return;
+	if (n < 0)
+		n = 0;
+	table = _hanzi_numerals_get();
+	do
 	{
+		digits[i++] = n % 10;
 		n /= 10;
-		str = g_string_append(str, _(hanzi_num[n]));
-		str = g_string_append(str, _(hanzi_num[10]));
-	}
-	else if ((n / 10) == 1)
-	{
-		n = n % 10;
-		str = g_string_append(str, _(hanzi_num[10]));
-		str = g_string_append(str, _(hanzi_num[n]));
-	}
-	else if (n > 10)
+	} while (n > 0 && i < (int) G_N_ELEMENTS(digits));
+
+	while (i-- > 0)
+		_hanzi_copy(hanzi, len, &pos, table->digit[digits[i]], table->digit_len[digits[i]]);
+	hanzi[pos] = '\0';
+}
+
+void mday_2_hanzi(int n, char* hanzi, gulong len)
+{
+	const HanziNumerals *table;
+	gulong pos = 0;
+
+	if (n < 0 || n >= (int) G_N_ELEMENTS(table->mday))
 	{
-		d = n % 10;
-		n = n/10;
-		str = g_string_append(str, _(hanzi_num[n]));
-		str = g_string_append(str, _(hanzi_num[10]));
-		str = g_string_append(str, _(hanzi_num[d]));
+		num_2_hanzi(n < 0 ? 0 : n, hanzi, len);
+		return;
 	}
-	else
-		str = g_string_append(str, _(hanzi_num[n]));
-
-	g_snprintf(hanzi, len, "%s", str->str);
-	g_string_free(str, TRUE);
+	if (len == 0)
+		return;
+	table = _hanzi_numerals_get();
+	_hanzi_copy(hanzi, len, &pos, table->mday[n], table->mday_len[n]);
+	hanzi[pos] = '\0';
 }
 
 char* str_replace(const gchar* string, const gchar* old, const gchar* new)
@@ -33,6 +33,8 @@ G_BEGIN_DECLS
 #define BEGIN_YEAR	1900	/* Note that LC1900.1.1 is SC1900.1.31 */
 #define NUM_OF_YEARS 150
 #define NUM_OF_MONTHS 13
+/* room for the months of all the years, leap months included */
+#define MAX_LUNAR_MONTHS	(NUM_OF_YEARS * NUM_OF_MONTHS)
 
 typedef struct	_CLDate				 CLDate;
 
@@ -302,8 +304,32 @@ static char *hanzi_num[] = {
 	N_("sh\303\255")
 };
 
+/* Day numbers count the days since BEGIN_YEAR.1.1 of the lunar calendar,
+ * the day of this GDate julian day. */
+#define LUNAR_DAYS_JULIAN	693626
+
+extern guint	_lunar_year_days[NUM_OF_YEARS];
+extern glong	_lunar_year_start[NUM_OF_YEARS + 1];
+extern glong	_lunar_month_start[MAX_LUNAR_MONTHS + 1];
+extern guint16	_lunar_year_month[NUM_OF_YEARS + 1];
+
+/* the days of a month, by its place in _lunar_month_start[] */
+#define _lunar_month_days(ordinal) \
+	(_lunar_month_start[(ordinal) + 1] - _lunar_month_start[(ordinal)])
+
+void	_lunar_tables_init (void);
+void	_lunar_date_init_i18n (void);
+gint	_lunar_make_month_days (gint year, guint *month_days);
+glong	_lunar_to_days (gint year, gint month, gint day, gboolean isleap, GError **error);
+gboolean _lunar_from_days (glong days, gint *year, gint *month, gint *day, gboolean *isleap);
+gint	_lunar_month_ordinal (gint year, gint month, gboolean isleap);
+void	_lunar_month_from_ordinal (gint ordinal, gint *year, gint *month, gboolean *isleap);
+gint	_lunar_month_find (glong days);
+
 gboolean leap (guint year);
 gint	_cmp_date (gint month1, gint day1, gint month2, gint day2);
+void	_solar_term_date (gint year, gint n, gint *ry, gint *rm, gint *rd);
+const gchar* _solar_term_name (gint n);
 void	year_jieqi(int year, int n, char* result);
 gint	get_day_of_week (gint year, gint month, gint day);
 glong _date_calc_days_since_reference_year (CLDate *d, GError **error);
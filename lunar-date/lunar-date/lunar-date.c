@@ -40,6 +40,7 @@
 #include <lunar-date/lunar-date.h>
 #include <lunar-date/lunar-version.h>
 #include "lunar-date-private.h"
+#include "lunar-holiday-private.h"
 
 /**
  * SECTION:lunar-date
@@ -69,10 +70,7 @@ struct _LunarDatePrivate
 	CLDate *gan2;
 	CLDate *zhi2;
 	glong	days;
-	guint	lunar_year_months[NUM_OF_YEARS];
-	guint	lunar_year_days[NUM_OF_YEARS];
-	guint	lunar_month_days[NUM_OF_MONTHS +1];
-	GKeyFile* keyfile;
+	LunarHolidaySet *holidays;		/* looked up on the first holiday access */
 };
 
 static void lunar_date_set_property  (GObject		   *object,
@@ -83,8 +81,8 @@ static void lunar_date_get_property  (GObject		   *object,
 										 guint			   prop_id,
 										 GValue			  *value,
 										 GParamSpec		  *pspec);
-static void _cl_date_make_all_lunar_data(LunarDate *date);
-static void lunar_date_init_i18n(void);
+
+static void lunar_date_finalize	  (GObject		   *object);
 
 G_DEFINE_TYPE (LunarDate, lunar_date, G_TYPE_OBJECT);
 
@@ -95,20 +93,20 @@ lunar_date_class_init (LunarDateClass *class)
 
 	gobject_class->set_property = lunar_date_set_property;
 	gobject_class->get_property = lunar_date_get_property;
+	gobject_class->finalize = lunar_date_finalize;
 
 	g_type_class_add_private (class, sizeof (LunarDatePrivate));
+	_lunar_tables_init();
 }
 
 static void
 lunar_date_init (LunarDate *date)
 {
-	gchar *cfgfile;
 	LunarDatePrivate *priv;
 	
 	priv = LUNAR_DATE_GET_PRIVATE (date);
-	lunar_date_init_i18n();
+	_lunar_date_init_i18n();
 
-	priv->keyfile = g_key_file_new();
 	priv->solar = g_new0 (CLDate, 1);
 	priv->lunar = g_new0 (CLDate, 1);
 	priv->lunar2 = g_new0 (CLDate, 1);
@@ -116,45 +114,6 @@ lunar_date_init (LunarDate *date)
 	priv->zhi	= g_new0 (CLDate, 1);
 	priv->gan2	 = g_new0 (CLDate, 1);
 	priv->zhi2	 = g_new0 (CLDate, 1);
-
-	cfgfile = g_build_filename(g_get_user_config_dir() , "liblunar", "holiday.dat", NULL);
-	if (!g_file_test(cfgfile, G_FILE_TEST_EXISTS |G_FILE_TEST_IS_REGULAR))
-	{
-		const gchar* const * langs =  g_get_language_names();
-		int i = 0;
-		while(langs[i] && langs[i][0] != '\0')
-		{
-			if (g_str_has_prefix(langs[i], "zh_") &&  (strlen(langs[i])>= 5))
-			{
-				gchar *lang = g_strconcat("holiday.", g_strndup(langs[i], 5), NULL);
-				g_free(cfgfile);
-#ifdef RUN_IN_SOURCE_TREE
-				cfgfile = g_build_filename("..", "data", lang, NULL);
-				if ( !g_file_test(cfgfile, G_FILE_TEST_EXISTS |G_FILE_TEST_IS_REGULAR))
-				{
-					g_free(cfgfile);
-					cfgfile = g_build_filename("date", lang, NULL);
-				}
-#else
-				cfgfile = g_build_filename(LUNAR_HOLIDAYDIR, lang, NULL);
-#endif
-				if (g_file_test(cfgfile, G_FILE_TEST_EXISTS |G_FILE_TEST_IS_REGULAR))
-				{
-					break;
-				}
-				g_free(lang);
-			}
-			i++;
-		}
-	}
-
-	if (!g_key_file_load_from_file(priv->keyfile, cfgfile, G_KEY_FILE_KEEP_COMMENTS, NULL))
-	{
-		g_critical("Format error \"%s\" !!!\n", cfgfile);
-	}
-	g_free(cfgfile);
-
-	_cl_date_make_all_lunar_data(date);
 }
 
 /**
@@ -210,7 +169,6 @@ lunar_date_get_property (GObject	  *object,
 
 static void _cl_date_calc_lunar(LunarDate *date, GError **error);
 static void _cl_date_calc_solar(LunarDate *date, GError **error);
-static gint _cl_date_make_lunar_month_days(LunarDate *date, gint year);
 static void _cl_date_days_to_lunar (LunarDate *date, GError **error);
 static void _cl_date_days_to_solar(LunarDate *date, GError **error);
 static void _cl_date_calc_ganzhi(LunarDate *date);
@@ -228,6 +186,58 @@ GQuark lunar_date_error_quark (void)
 	return quark;
 }
 
+/*
+ * Stores a date lunar_date_validate_solar() took and computes the rest,
+ * shared by the setters.
+ */
+static gboolean _cl_date_apply_solar (LunarDate *date, GDateYear year, GDateMonth month,
+		GDateDay day, guint8 hour, GError **error)
+{
+	LunarDatePrivate *priv;
+	GError *calc_error = NULL;
+
+	priv = LUNAR_DATE_GET_PRIVATE (date);
+	priv->solar->year = year;
+	priv->solar->month = month;
+	priv->solar->day = day;
+	priv->solar->hour = hour == 24 ? 0 : hour;
+	/* 计算农历 */
+	_cl_date_calc_lunar(date, &calc_error);
+	if (calc_error != NULL)
+	{
+		g_propagate_error (error, calc_error);
+		return FALSE;
+	}
+	_cl_date_calc_ganzhi(date);
+	_cl_date_calc_bazi(date);
+	return TRUE;
+}
+
+/* Like _cl_date_apply_solar(), for lunar_date_validate_lunar(). */
+static gboolean _cl_date_apply_lunar (LunarDate *date, GDateYear year, GDateMonth month,
+		GDateDay day, guint8 hour, gboolean isleap, GError **error)
+{
+	LunarDatePrivate *priv;
+	GError *calc_error = NULL;
+
+	priv = LUNAR_DATE_GET_PRIVATE (date);
+	priv->lunar->year = year;
+	priv->lunar->month = month;
+	priv->lunar->day = day;
+	priv->lunar->hour = hour == 24 ? 0 : hour;
+	priv->lunar->isleap = isleap;
+	/* 计算公历 */
+	_cl_date_calc_solar(date, &calc_error);
+	if (calc_error != NULL)
+	{
+		g_propagate_error (error, calc_error);
+		return FALSE;
+	}
+	_cl_date_calc_ganzhi(date);
+	_cl_date_calc_bazi(date);
+	return TRUE;
+}
+
 /**
  * lunar_date_set_solar_date:
  * @date: a #LunarDate.
@@ -237,7 +247,9 @@ GQuark lunar_date_error_quark (void)
  * @hour: hour to set.
  * @error: location to store the error occuring, or NULL to ignore errors.
  *
- * Sets the solar year, month, day and the hour for a #LunarDate.
+ * Sets the solar year, month, day and the hour for a #LunarDate.  The
+ * date is checked with lunar_date_validate_solar(), on error it is left
+ * as it was.
  **/
 void			lunar_date_set_solar_date	  (LunarDate *date,
 		GDateYear year,
@@ -246,217 +258,1602 @@ void			lunar_date_set_solar_date	  (LunarDate *date,
 		guint8 hour,
 		GError **error)
 {
-	LunarDatePrivate *priv;
-	GError *calc_error = NULL;
+	LunarDateError code;
 
-	priv = LUNAR_DATE_GET_PRIVATE (date);
-
-	if (year < BEGIN_YEAR || year > BEGIN_YEAR+NUM_OF_YEARS || (year == BEGIN_YEAR && month == 1))
+	if (!lunar_date_validate_solar(year, month, day, hour, &code))
 	{
-		g_set_error(error, LUNAR_DATE_ERROR,
-				LUNAR_DATE_ERROR_YEAR,
-				_("Year out of range."));
+		lunar_date_error_set(error, code);
 		return;
 	}
+	_cl_date_apply_solar(date, year, month, day, hour, error);
+}
+
+/**
+ * lunar_date_set_lunar_date:
+ * @date: a #LunarDate.
+ * @year: year to set.
+ * @month: month to set.
+ * @day: day to set.
+ * @hour: hour to set.
+ * @isleap: indicate whether the month is a leap month.
+ * @error: location to store the error occuring, or #NULL to ignore errors.
+ *
+ * Sets the lunar year, month, day and the hour for a #LunarDate. If the month is a leap month, you should set the isleap to TRUE.
+ * The date is checked with lunar_date_validate_lunar(), on error it is
+ * left as it was.
+ **/
+void			lunar_date_set_lunar_date	  (LunarDate *date,
+		GDateYear year,
+		GDateMonth month, 
+		GDateDay day,
+		guint8 hour,
+		gboolean isleap,
+		GError **error)
+{
+	LunarDateError code;
 
-	if (!g_date_valid_month(month))
+	if (!lunar_date_validate_lunar(year, month, day, hour, isleap, &code))
 	{
-		g_set_error(error, LUNAR_DATE_ERROR,
-				LUNAR_DATE_ERROR_MONTH,
-				_("Month out of range."));
+		/* the messages that name the month or the day, as before */
+		if (code == LUNAR_DATE_ERROR_LEAP)
+			g_set_error(error, LUNAR_DATE_ERROR, code,
+					_("%d is not a leap month in year %d.\n"), month, year);
+		else if (code == LUNAR_DATE_ERROR_DAY)
+			g_set_error(error, LUNAR_DATE_ERROR, code,
+					_("Day out of range: \"%d\""), day);
+		else
+			lunar_date_error_set(error, code);
 		return;
 	}
+	_cl_date_apply_lunar(date, year, month, day, hour, isleap, error);
+}
+
+/**
+ * lunar_date_error_set:
+ * @error: location to store the error, or %NULL.
+ * @code: a #LunarDateError
+ *
+ * Sets @error to a #LUNAR_DATE_ERROR of @code, with the message of the
+ * code, for the callers of lunar_date_validate_solar() and the like
+ * that need one.
+ **/
+void		lunar_date_error_set		  (GError **error, LunarDateError code)
+{
+	const gchar *message;
 
-	if (hour == 24) hour = 0;
-	if (hour < 0 || hour > 23)
+	switch (code)
 	{
-		g_set_error(error, LUNAR_DATE_ERROR,
-				LUNAR_DATE_ERROR_HOUR,
-				_("Hour out of range."));
-		return;
+		case LUNAR_DATE_ERROR_YEAR:
+			message = _("Year out of range.");
+			break;
+		case LUNAR_DATE_ERROR_MONTH:
+			message = _("Month out of range.");
+			break;
+		case LUNAR_DATE_ERROR_DAY:
+			message = _("Day out of range.");
+			break;
+		case LUNAR_DATE_ERROR_HOUR:
+			message = _("Hour out of range.");
+			break;
+		case LUNAR_DATE_ERROR_LEAP:
+			message = _("Not a leap month.");
+			break;
+		default:
+			message = _("Internal error.");
+			break;
 	}
+	g_set_error_literal(error, LUNAR_DATE_ERROR, code, message);
+}
 
-	priv->solar->year = year;
-	priv->solar->month = month;
-	priv->solar->day = day;
-	priv->solar->hour = hour;
-	/* 计算农历 */
-	_cl_date_calc_lunar(date, &calc_error);
-	if (calc_error != NULL)
+/* The checks of the year, the month and the hour both validators make. */
+static gboolean _cl_date_check (GDateYear year, GDateMonth month, guint8 hour,
+		gint last_year, LunarDateError *code)
+{
+	if (year < BEGIN_YEAR || year > last_year)
+		*code = LUNAR_DATE_ERROR_YEAR;
+	else if (!g_date_valid_month(month))
+		*code = LUNAR_DATE_ERROR_MONTH;
+	else if (hour > 24)
+		*code = LUNAR_DATE_ERROR_HOUR;
+	else
+		return TRUE;
+	return FALSE;
+}
+
+/**
+ * lunar_date_validate_solar:
+ * @year: the solar year.
+ * @month: the solar month.
+ * @day: the solar day.
+ * @hour: the hour.
+ * @code: (out) (allow-none): return location for the error, or %NULL.
+ *
+ * Checks a solar date the way lunar_date_set_solar_date() does, without
+ * allocating a #GError.  lunar_date_error_set() makes the #GError of
+ * @code if one is needed.
+ *
+ * Return value: %TRUE if lunar_date_set_solar_date() takes the date.
+ **/
+gboolean	lunar_date_validate_solar	  (GDateYear year, GDateMonth month, GDateDay day,
+		guint8 hour, LunarDateError *code)
+{
+	LunarDateError dummy;
+	GDate date;
+	glong days;
+
+	if (code == NULL)
+		code = &dummy;
+	if (!_cl_date_check(year, month, hour, BEGIN_YEAR + NUM_OF_YEARS, code))
+		return FALSE;
+	if (year == BEGIN_YEAR && month == G_DATE_JANUARY)
 	{
-		g_propagate_error (error, calc_error);
-		calc_error = NULL;
-		return;
+		*code = LUNAR_DATE_ERROR_YEAR;
+		return FALSE;
 	}
-	_cl_date_calc_ganzhi(date);
-	_cl_date_calc_bazi(date);
+	if (!g_date_valid_dmy(day, month, year))
+	{
+		*code = LUNAR_DATE_ERROR_DAY;
+		return FALSE;
+	}
+
+	g_date_clear(&date, 1);
+	g_date_set_dmy(&date, day, month, year);
+	days = (glong) g_date_get_julian(&date) - LUNAR_DAYS_JULIAN + (hour == 23);
+	_lunar_tables_init();
+	if (days >= _lunar_year_start[NUM_OF_YEARS])
+	{
+		*code = LUNAR_DATE_ERROR_YEAR;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * lunar_date_validate_lunar:
+ * @year: the lunar year.
+ * @month: the lunar month.
+ * @day: the lunar day.
+ * @hour: the hour.
+ * @isleap: whether @month is a leap month.
+ * @code: (out) (allow-none): return location for the error, or %NULL.
+ *
+ * Like lunar_date_validate_solar(), for lunar_date_set_lunar_date().
+ *
+ * Return value: %TRUE if lunar_date_set_lunar_date() takes the date.
+ **/
+gboolean	lunar_date_validate_lunar	  (GDateYear year, GDateMonth month, GDateDay day,
+		guint8 hour, gboolean isleap, LunarDateError *code)
+{
+	LunarDateError dummy;
+	GDate date;
+	gint ordinal;
+	glong days;
+
+	if (code == NULL)
+		code = &dummy;
+	if (!_cl_date_check(year, month, hour, BEGIN_YEAR + NUM_OF_YEARS - 1, code))
+		return FALSE;
+
+	_lunar_tables_init();
+	ordinal = _lunar_month_ordinal(year, month, isleap);
+	if (ordinal < 0)
+	{
+		*code = LUNAR_DATE_ERROR_LEAP;
+		return FALSE;
+	}
+	if (day < 1 || day > _lunar_month_days(ordinal))
+	{
+		*code = LUNAR_DATE_ERROR_DAY;
+		return FALSE;
+	}
+
+	/* the solar date must be in the supported years too */
+	days = _lunar_month_start[ordinal] + day - 1 - (hour == 23);
+	g_date_clear(&date, 1);
+	g_date_set_dmy(&date, 1, G_DATE_JANUARY, BEGIN_YEAR + NUM_OF_YEARS);
+	if (days < 0 || days + LUNAR_DAYS_JULIAN >= g_date_get_julian(&date))
+	{
+		*code = LUNAR_DATE_ERROR_YEAR;
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* A date the validators took cannot fail to apply, but say so if it does. */
+static gboolean _cl_date_try_apply (gboolean applied, LunarDateError *code)
+{
+	if (!applied && code != NULL)
+		*code = LUNAR_DATE_ERROR_INTERNAL;
+	return applied;
+}
+
+/**
+ * lunar_date_try_set_solar_date:
+ * @date: a #LunarDate.
+ * @year: the solar year.
+ * @month: the solar month.
+ * @day: the solar day.
+ * @hour: the hour.
+ * @code: (out) (allow-none): return location for the error, or %NULL.
+ *
+ * Like lunar_date_set_solar_date(), reporting an error as a code, see
+ * lunar_date_validate_solar().  On error the date is left as it was.
+ *
+ * Return value: %TRUE if the date was set.
+ **/
+gboolean	lunar_date_try_set_solar_date (LunarDate *date, GDateYear year, GDateMonth month,
+		GDateDay day, guint8 hour, LunarDateError *code)
+{
+	g_return_val_if_fail(LUNAR_IS_DATE(date), FALSE);
+
+	if (!lunar_date_validate_solar(year, month, day, hour, code))
+		return FALSE;
+	return _cl_date_try_apply(_cl_date_apply_solar(date, year, month, day, hour, NULL), code);
+}
+
+/**
+ * lunar_date_try_set_lunar_date:
+ * @date: a #LunarDate.
+ * @year: the lunar year.
+ * @month: the lunar month.
+ * @day: the lunar day.
+ * @hour: the hour.
+ * @isleap: whether @month is a leap month.
+ * @code: (out) (allow-none): return location for the error, or %NULL.
+ *
+ * Like lunar_date_set_lunar_date(), reporting an error as a code, see
+ * lunar_date_validate_lunar().  On error the date is left as it was.
+ *
+ * Return value: %TRUE if the date was set.
+ **/
+gboolean	lunar_date_try_set_lunar_date (LunarDate *date, GDateYear year, GDateMonth month,
+		GDateDay day, guint8 hour, gboolean isleap, LunarDateError *code)
+{
+	g_return_val_if_fail(LUNAR_IS_DATE(date), FALSE);
+
+	if (!lunar_date_validate_lunar(year, month, day, hour, isleap, code))
+		return FALSE;
+	return _cl_date_try_apply(_cl_date_apply_lunar(date, year, month, day, hour, isleap, NULL), code);
+}
+
+/**
+ * lunar_date_get_lunar_year:
+ * @date: a #LunarDate
+ *
+ * Return value: the lunar year of the date.
+ **/
+GDateYear	lunar_date_get_lunar_year	  (LunarDate *date)
+{
+	g_return_val_if_fail(LUNAR_IS_DATE(date), 0);
+
+	return LUNAR_DATE_GET_PRIVATE (date)->lunar->year;
+}
+
+/**
+ * lunar_date_get_lunar_month:
+ * @date: a #LunarDate
+ *
+ * Return value: the lunar month of the date, from 1 to 12, see
+ * lunar_date_get_lunar_isleap().
+ **/
+guint		lunar_date_get_lunar_month	  (LunarDate *date)
+{
+	g_return_val_if_fail(LUNAR_IS_DATE(date), 0);
+
+	return LUNAR_DATE_GET_PRIVATE (date)->lunar->month;
+}
+
+/**
+ * lunar_date_get_lunar_day:
+ * @date: a #LunarDate
+ *
+ * Return value: the lunar day of the date, from 1 to 30.
+ **/
+guint		lunar_date_get_lunar_day	  (LunarDate *date)
+{
+	g_return_val_if_fail(LUNAR_IS_DATE(date), 0);
+
+	return LUNAR_DATE_GET_PRIVATE (date)->lunar->day;
+}
+
+/**
+ * lunar_date_get_lunar_isleap:
+ * @date: a #LunarDate
+ *
+ * Return value: %TRUE if the lunar month of the date is a leap month.
+ **/
+gboolean	lunar_date_get_lunar_isleap	  (LunarDate *date)
+{
+	g_return_val_if_fail(LUNAR_IS_DATE(date), FALSE);
+
+	return LUNAR_DATE_GET_PRIVATE (date)->lunar->isleap;
+}
+
+/* The place of a gan-zhi pair in the cycle of 60, 0 being Jiazi. */
+static guint _cl_date_pillar (LunarDatePrivate *priv, CLDate *gan, CLDate *zhi, LunarDatePillar pillar)
+{
+	guint g, z;
+
+	switch (pillar)
+	{
+		case LUNAR_DATE_PILLAR_YEAR:
+			g = gan->year;
+			z = zhi->year;
+			break;
+		case LUNAR_DATE_PILLAR_MONTH:
+			g = gan->month;
+			z = zhi->month;
+			break;
+		case LUNAR_DATE_PILLAR_DAY:
+			g = gan->day;
+			z = zhi->day;
+			break;
+		default:
+			/* the same for both, as %(H60) and %(H8) */
+			z = (priv->lunar->hour + 1) % 24 / 2;
+			g = (priv->gan2->day % 5 * 2 + z) % 10;
+			break;
+	}
+	/* g = n % 10 and z = n % 12 */
+	return (6 * g + 55 * z) % 60;
+}
+
+/**
+ * lunar_date_get_ganzhi:
+ * @date: a #LunarDate
+ * @pillar: the pillar to get.
+ *
+ * Gets the gan-zhi of a pillar of the date, as %(Y60), %(M60), %(D60)
+ * and %(H60) show it.  The gan is the value modulo 10, from Jia, and
+ * the zhi the value modulo 12, from Zi.
+ *
+ * Return value: the place of the gan-zhi in the cycle of 60, 0 being
+ * Jiazi.
+ **/
+guint		lunar_date_get_ganzhi		  (LunarDate *date, LunarDatePillar pillar)
+{
+	LunarDatePrivate *priv;
+
+	g_return_val_if_fail(LUNAR_IS_DATE(date), 0);
+
+	priv = LUNAR_DATE_GET_PRIVATE (date);
+	return _cl_date_pillar(priv, priv->gan, priv->zhi, pillar);
+}
+
+/**
+ * lunar_date_get_bazi:
+ * @date: a #LunarDate
+ * @pillar: the pillar to get.
+ *
+ * Like lunar_date_get_ganzhi(), for the bazi, whose years and months
+ * begin with the solar terms, as %(Y8), %(M8), %(D8) and %(H8) show
+ * them.
+ *
+ * Return value: the place of the gan-zhi in the cycle of 60, 0 being
+ * Jiazi.
+ **/
+guint		lunar_date_get_bazi			  (LunarDate *date, LunarDatePillar pillar)
+{
+	LunarDatePrivate *priv;
+
+	g_return_val_if_fail(LUNAR_IS_DATE(date), 0);
+
+	priv = LUNAR_DATE_GET_PRIVATE (date);
+	return _cl_date_pillar(priv, priv->gan2, priv->zhi2, pillar);
+}
+
+/**
+ * lunar_date_get_zodiac:
+ * @date: a #LunarDate
+ *
+ * Gets the zodiac animal of the lunar year, as %(shengxiao) shows it.
+ *
+ * Return value: the animal, from 0 for the rat to 11 for the pig.
+ **/
+guint		lunar_date_get_zodiac		  (LunarDate *date)
+{
+	g_return_val_if_fail(LUNAR_IS_DATE(date), 0);
+
+	return LUNAR_DATE_GET_PRIVATE (date)->zhi->year;
+}
+
+/**
+ * lunar_date_get_days:
+ * @date: a #LunarDate
+ *
+ * Gets the number of the lunar day of the date, counted from January
+ * 31, 1900, the first day of the supported range.  The lunar day begins
+ * at 23 o'clock, so from then on the number is that of the next solar
+ * day.  g_date_set_julian() takes the number plus 693626.
+ *
+ * Return value: the day number.
+ **/
+glong		lunar_date_get_days			  (LunarDate *date)
+{
+	g_return_val_if_fail(LUNAR_IS_DATE(date), 0);
+
+	return LUNAR_DATE_GET_PRIVATE (date)->days;
+}
+
+/**
+ * lunar_date_get_info:
+ * @date: a #LunarDate
+ * @info: (out caller-allocates): return location for the numbers.
+ *
+ * Fills @info with all the numbers of the date at once.
+ **/
+void		lunar_date_get_info			  (LunarDate *date, LunarDayInfo *info)
+{
+	LunarDatePrivate *priv;
+	gint i;
+
+	g_return_if_fail(LUNAR_IS_DATE(date));
+	g_return_if_fail(info != NULL);
+
+	priv = LUNAR_DATE_GET_PRIVATE (date);
+	info->solar_year = priv->solar->year;
+	info->solar_month = priv->solar->month;
+	info->solar_day = priv->solar->day;
+	info->hour = priv->solar->hour;
+	info->lunar_year = priv->lunar->year;
+	info->lunar_month = priv->lunar->month;
+	info->lunar_day = priv->lunar->day;
+	info->lunar_isleap = priv->lunar->isleap;
+	for (i = LUNAR_DATE_PILLAR_YEAR; i <= LUNAR_DATE_PILLAR_HOUR; i++)
+	{
+		info->ganzhi[i] = _cl_date_pillar(priv, priv->gan, priv->zhi, i);
+		info->bazi[i] = _cl_date_pillar(priv, priv->gan2, priv->zhi2, i);
+	}
+	info->zodiac = priv->zhi->year;
+	info->days = priv->days;
+}
+
+/**
+ * lunar_year_get_info:
+ * @year: a lunar year.
+ * @info: (out caller-allocates): return location for the numbers.
+ *
+ * Fills @info with the numbers of a lunar year, from the year tables
+ * without converting any date.
+ *
+ * Return value: %FALSE if @year is out of range.
+ **/
+gboolean	lunar_year_get_info			  (GDateYear year, LunarYearInfo *info)
+{
+	GDate date;
+	gint y, i, ty, tm, td;
+
+	g_return_val_if_fail(info != NULL, FALSE);
+
+	if (year < BEGIN_YEAR || year >= BEGIN_YEAR + NUM_OF_YEARS)
+		return FALSE;
+
+	_lunar_tables_init();
+	y = year - BEGIN_YEAR;
+	info->year = year;
+	info->julian = _lunar_year_start[y] + LUNAR_DAYS_JULIAN;
+	info->n_days = _lunar_year_days[y];
+	info->n_months = _lunar_year_month[y + 1] - _lunar_year_month[y];
+	info->leap_month = years_info[y] & 0xf;
+	for (i = 0; i < info->n_months; i++)
+		info->month_days[i] = _lunar_month_days(_lunar_year_month[y] + i);
+	for (; i < (gint) G_N_ELEMENTS(info->month_days); i++)
+		info->month_days[i] = 0;
+	/* as _cl_date_calc_ganzhi() */
+	info->ganzhi = (y + 36) % 60;
+	info->zodiac = (first_zhi_date.year + y) % 12;
+
+	g_date_clear(&date, 1);
+	for (i = 0; i < 24; i++)
+	{
+		_solar_term_date(year, i, &ty, &tm, &td);
+		g_date_set_dmy(&date, td, tm, ty);
+		info->terms[i] = g_date_get_julian(&date);
+	}
+	return TRUE;
+}
+
+/**
+ * lunar_date_pack:
+ * @date: a #LunarDate
+ * @with_hour: whether to keep the hour.
+ *
+ * Packs the lunar date into an integer, to store it or to use it as a
+ * key.  The packed dates compare as the dates do, a leap month after
+ * the month it repeats, and with @with_hour the hours after 23 o'clock,
+ * which begins the lunar day.  A date without the hour comes before
+ * that day with any hour.  The bits, from the highest, are:
+ *
+ * |[
+ *	 0 yyyyyyyyyyyyyyyy mmmmm ddddd hhhhh
+ * ]|
+ *
+ * where m is twice the month plus 1 for a leap month, and h is 0 for no
+ * hour, 1 for 23 o'clock and the hour plus 2 for the others.
+ *
+ * Return value: the packed date, see lunar_date_unpack().
+ **/
+guint32		lunar_date_pack				  (LunarDate *date, gboolean with_hour)
+{
+	CLDate *lunar;
+	guint32 packed;
+
+	g_return_val_if_fail(LUNAR_IS_DATE(date), 0);
+
+	lunar = LUNAR_DATE_GET_PRIVATE (date)->lunar;
+	packed = LUNAR_DATE_PACK(lunar->year, lunar->month, lunar->isleap, lunar->day);
+	if (with_hour)
+		packed |= (lunar->hour + 1) % 24 + 1;
+	return packed;
+}
+
+/**
+ * lunar_date_unpack:
+ * @date: a #LunarDate
+ * @packed: a date from lunar_date_pack() or LUNAR_DATE_PACK().
+ * @error: location to store the error occuring, or %NULL to ignore errors.
+ *
+ * Sets the date to a packed lunar date, at hour 0 if it has no hour, as
+ * lunar_date_set_lunar_date() does.
+ **/
+void		lunar_date_unpack			  (LunarDate *date, guint32 packed, GError **error)
+{
+	guint month, hour;
+
+	g_return_if_fail(LUNAR_IS_DATE(date));
+
+	month = (packed >> 10) & 0x1f;
+	hour = packed & 0x1f;
+	if (month < 2 || month > 25)
+	{
+		g_set_error(error, LUNAR_DATE_ERROR,
+				LUNAR_DATE_ERROR_MONTH,
+				_("Month out of range."));
+		return;
+	}
+	if (hour > 24)
+	{
+		g_set_error(error, LUNAR_DATE_ERROR,
+				LUNAR_DATE_ERROR_HOUR,
+				_("Hour out of range."));
+		return;
+	}
+	lunar_date_set_lunar_date(date, packed >> 15, month / 2, (packed >> 5) & 0x1f,
+			hour == 0 ? 0 : (hour + 22) % 24, month % 2, error);
+}
+
+/*
+ * Moves the date to day number @days, keeping the hour, and computes
+ * the rest from it.  The solar date comes from the julian day, the lunar
+ * one from the month tables.
+ */
+static void _cl_date_set_days (LunarDate *date, glong days, GError **error)
+{
+	LunarDatePrivate *priv;
+	gint year, month, day;
+	gboolean isleap;
+	GDate solar;
+	glong solar_days;
+
+	priv = LUNAR_DATE_GET_PRIVATE (date);
+
+	/* a lunar day begins at 11 p.m. of the solar day before */
+	solar_days = days - (priv->solar->hour == 23);
+	g_date_clear(&solar, 1);
+	if (solar_days >= 1)
+		g_date_set_julian(&solar, solar_days + LUNAR_DAYS_JULIAN);
+	/* the same range as the lunar dates the solar ones convert to */
+	if (solar_days < 1 || g_date_get_year(&solar) >= BEGIN_YEAR + NUM_OF_YEARS
+			|| !_lunar_from_days(days, &year, &month, &day, &isleap))
+	{
+		g_set_error(error, LUNAR_DATE_ERROR,
+				LUNAR_DATE_ERROR_YEAR,
+				_("Year out of range."));
+		return;
+	}
+
+	priv->days = days;
+	priv->lunar->year = year;
+	priv->lunar->month = month;
+	priv->lunar->day = day;
+	priv->lunar->isleap = isleap;
+	priv->solar->year = g_date_get_year(&solar);
+	priv->solar->month = g_date_get_month(&solar);
+	priv->solar->day = g_date_get_day(&solar);
+	_cl_date_calc_ganzhi(date);
+	_cl_date_calc_bazi(date);
+}
+
+/*
+ * Moves the date to day @day of the month at @ordinal, clamped as
+ * @clamp allows.
+ */
+static void _cl_date_set_month (LunarDate *date, gint ordinal, gint day,
+		LunarDateClamp clamp, GError **error)
+{
+	if (ordinal < 0 || ordinal >= _lunar_year_month[NUM_OF_YEARS])
+	{
+		g_set_error(error, LUNAR_DATE_ERROR,
+				LUNAR_DATE_ERROR_YEAR,
+				_("Year out of range."));
+		return;
+	}
+	if (day > _lunar_month_days(ordinal))
+	{
+		if (!(clamp & LUNAR_DATE_CLAMP_DAY))
+		{
+			g_set_error(error, LUNAR_DATE_ERROR,
+					LUNAR_DATE_ERROR_DAY,
+					_("Day out of range: \"%d\""),
+					day);
+			return;
+		}
+		day = _lunar_month_days(ordinal);
+	}
+	_cl_date_set_days(date, _lunar_month_start[ordinal] + day - 1, error);
+}
+
+/**
+ * lunar_date_add_days:
+ * @date: a #LunarDate
+ * @n_days: the number of days to add, may be negative.
+ * @error: location to store the error occuring, or %NULL to ignore errors.
+ *
+ * Moves the date by @n_days days, keeping the hour.  If the result is
+ * out of the supported years, the date is left as it was.
+ **/
+void		lunar_date_add_days			  (LunarDate *date, glong n_days, GError **error)
+{
+	g_return_if_fail(LUNAR_IS_DATE(date));
+
+	_cl_date_set_days(date, LUNAR_DATE_GET_PRIVATE (date)->days + n_days, error);
+}
+
+/**
+ * lunar_date_add_months:
+ * @date: a #LunarDate
+ * @n_months: the number of lunar months to add, may be negative.
+ * @clamp: what to do if the day is not in the month reached.
+ * @error: location to store the error occuring, or %NULL to ignore errors.
+ *
+ * Moves the date by @n_months lunar months, keeping the day and the
+ * hour.  Leap months count as months, one month after the fourth month
+ * of a year with a leap fourth month is that leap month.  Day 30 of a
+ * month that reaches one of 29 days is an error, unless @clamp has
+ * %LUNAR_DATE_CLAMP_DAY.  On error the date is left as it was.
+ **/
+void		lunar_date_add_months		  (LunarDate *date, gint n_months,
+		LunarDateClamp clamp, GError **error)
+{
+	LunarDatePrivate *priv;
+	gint ordinal;
+
+	g_return_if_fail(LUNAR_IS_DATE(date));
+
+	priv = LUNAR_DATE_GET_PRIVATE (date);
+	ordinal = _lunar_month_ordinal(priv->lunar->year, priv->lunar->month, priv->lunar->isleap);
+	_cl_date_set_month(date, ordinal + n_months, priv->lunar->day, clamp, error);
+}
+
+/**
+ * lunar_date_add_years:
+ * @date: a #LunarDate
+ * @n_years: the number of lunar years to add, may be negative.
+ * @clamp: what to do if the month or the day is not in the year reached.
+ * @error: location to store the error occuring, or %NULL to ignore errors.
+ *
+ * Moves the date by @n_years lunar years, keeping the month, the day
+ * and the hour.  A leap month the year reached does not have is an
+ * error, unless @clamp has %LUNAR_DATE_CLAMP_LEAP, and so is day 30 of
+ * a month of 29 days, unless @clamp has %LUNAR_DATE_CLAMP_DAY.  On error
+ * the date is left as it was.
+ **/
+void		lunar_date_add_years		  (LunarDate *date, gint n_years,
+		LunarDateClamp clamp, GError **error)
+{
+	LunarDatePrivate *priv;
+	gint year, ordinal;
+	gboolean isleap;
+
+	g_return_if_fail(LUNAR_IS_DATE(date));
+
+	priv = LUNAR_DATE_GET_PRIVATE (date);
+	year = priv->lunar->year + n_years;
+	if (year < BEGIN_YEAR || year >= BEGIN_YEAR + NUM_OF_YEARS)
+	{
+		g_set_error(error, LUNAR_DATE_ERROR,
+				LUNAR_DATE_ERROR_YEAR,
+				_("Year out of range."));
+		return;
+	}
+	isleap = priv->lunar->isleap;
+	ordinal = _lunar_month_ordinal(year, priv->lunar->month, isleap);
+	if (ordinal < 0 && (clamp & LUNAR_DATE_CLAMP_LEAP))
+		ordinal = _lunar_month_ordinal(year, priv->lunar->month, FALSE);
+	if (ordinal < 0)
+	{
+		g_set_error(error, LUNAR_DATE_ERROR,
+				LUNAR_DATE_ERROR_LEAP,
+				_("%d is not a leap month in year %d.\n"), 
+				priv->lunar->month, year);
+		return;
+	}
+	_cl_date_set_month(date, ordinal, priv->lunar->day, clamp, error);
+}
+
+/**
+ * lunar_date_days_between:
+ * @date1: a #LunarDate
+ * @date2: a #LunarDate
+ *
+ * Counts the lunar days from @date1 to @date2.  A lunar day begins at
+ * 23 o'clock, so the hours of the dates matter.
+ *
+ * Return value: the number of days, negative if @date2 comes before
+ * @date1.
+ **/
+glong		lunar_date_days_between		  (LunarDate *date1, LunarDate *date2)
+{
+	g_return_val_if_fail(LUNAR_IS_DATE(date1), 0);
+	g_return_val_if_fail(LUNAR_IS_DATE(date2), 0);
+
+	return LUNAR_DATE_GET_PRIVATE (date2)->days - LUNAR_DATE_GET_PRIVATE (date1)->days;
+}
+
+/*
+ * Moves the date to the first day @month @day, or clamped as @clamp
+ * allows, on or after the date, or if @backward the last one on or
+ * before it.  Looks at a year at a time, at most the years of the table.
+ */
+static void _cl_date_find_lunar (LunarDate *date, gint month, gint day, gboolean isleap,
+		LunarDateClamp clamp, gboolean backward, GError **error)
+{
+	LunarDatePrivate *priv;
+	gint year, ordinal, n;
+	glong days;
+
+	priv = LUNAR_DATE_GET_PRIVATE (date);
+	for (year = priv->lunar->year; year >= BEGIN_YEAR && year < BEGIN_YEAR + NUM_OF_YEARS;
+			year += backward ? -1 : 1)
+	{
+		ordinal = _lunar_month_ordinal(year, month, isleap);
+		if (ordinal < 0 && (clamp & LUNAR_DATE_CLAMP_LEAP))
+			ordinal = _lunar_month_ordinal(year, month, FALSE);
+		if (ordinal < 0)
+			continue;
+		n = day;
+		if (n > _lunar_month_days(ordinal))
+		{
+			if (!(clamp & LUNAR_DATE_CLAMP_DAY))
+				continue;
+			n = _lunar_month_days(ordinal);
+		}
+		days = _lunar_month_start[ordinal] + n - 1;
+		if (backward ? days <= priv->days : days >= priv->days)
+		{
+			_cl_date_set_days(date, days, error);
+			return;
+		}
+	}
+	g_set_error(error, LUNAR_DATE_ERROR,
+			LUNAR_DATE_ERROR_YEAR,
+			_("Year out of range."));
+}
+
+/*
+ * Moves the date to the first lunar year on or after it, or if @backward
+ * the last one on or before it, whose (year - BEGIN_YEAR + @offset) %
+ * @period is @value, at its first day, or if @backward its last one.
+ */
+static void _cl_date_find_year (LunarDate *date, gint offset, gint period, gint value,
+		gboolean backward, GError **error)
+{
+	LunarDatePrivate *priv;
+	gint year, n;
+
+	priv = LUNAR_DATE_GET_PRIVATE (date);
+	year = priv->lunar->year;
+	n = (value - (year - BEGIN_YEAR + offset) % period + period) % period;
+	if (n == 0)
+		return;
+	year += backward ? n - period : n;
+	if (year < BEGIN_YEAR || year >= BEGIN_YEAR + NUM_OF_YEARS)
+	{
+		g_set_error(error, LUNAR_DATE_ERROR,
+				LUNAR_DATE_ERROR_YEAR,
+				_("Year out of range."));
+		return;
+	}
+	/* the last day of a year is the one before the next year */
+	_cl_date_set_days(date, _lunar_month_start[_lunar_year_month[year - BEGIN_YEAR + backward]] - backward, error);
+}
+
+/*
+ * Like _cl_date_find_year(), for the month gan-zhi.  The leap months
+ * take that of the month before, so each year has 12 and the cycle is
+ * 5 years long.
+ */
+static void _cl_date_find_month (LunarDate *date, gint ganzhi, gboolean backward, GError **error)
+{
+	LunarDatePrivate *priv;
+	gint index, n, year, ordinal;
+
+	priv = LUNAR_DATE_GET_PRIVATE (date);
+	/* the months from the first one of 1900, a Geng year: Wuyin, place 14 */
+	index = (priv->lunar->year - BEGIN_YEAR) * 12 + priv->lunar->month - 1;
+	n = (ganzhi - (index + 14) % 60 + 60) % 60;
+	if (n == 0)
+		return;
+	/* the last day of a month, leap month after it included, is the one
+	 * before the next month */
+	index += backward ? n - 60 + 1 : n;
+	if (index < backward || index >= NUM_OF_YEARS * 12 + backward)
+	{
+		g_set_error(error, LUNAR_DATE_ERROR,
+				LUNAR_DATE_ERROR_YEAR,
+				_("Year out of range."));
+		return;
+	}
+	year = BEGIN_YEAR + index / 12;
+	if (year == BEGIN_YEAR + NUM_OF_YEARS)
+		ordinal = _lunar_year_month[NUM_OF_YEARS];
+	else
+		ordinal = _lunar_month_ordinal(year, index % 12 + 1, FALSE);
+	_cl_date_set_days(date, _lunar_month_start[ordinal] - backward, error);
+}
+
+static void _cl_date_find_ganzhi (LunarDate *date, LunarDatePillar pillar, gint ganzhi,
+		gboolean backward, GError **error)
+{
+	glong days;
+	gint n;
+
+	switch (pillar)
+	{
+		case LUNAR_DATE_PILLAR_YEAR:
+			/* 1900 is Gengzi */
+			_cl_date_find_year(date, 36, 60, ganzhi, backward, error);
+			break;
+		case LUNAR_DATE_PILLAR_MONTH:
+			_cl_date_find_month(date, ganzhi, backward, error);
+			break;
+		default:
+			/* the days go round the cycle, the first one is Jiachen */
+			days = LUNAR_DATE_GET_PRIVATE (date)->days;
+			n = (ganzhi - (gint) ((days + 40) % 60) + 60) % 60;
+			if (n != 0)
+				_cl_date_set_days(date, days + (backward ? n - 60 : n), error);
+			break;
+	}
+}
+
+/**
+ * lunar_date_next_lunar:
+ * @date: a #LunarDate
+ * @month: the lunar month, from 1 to 12.
+ * @day: the lunar day, from 1 to 30.
+ * @isleap: whether @month is a leap month.
+ * @clamp: what to do in the years without the month or the day.
+ * @error: location to store the error occuring, or %NULL to ignore errors.
+ *
+ * Moves the date to the next lunar @month @day, keeping the hour.  The
+ * date itself is the next one if it is that day.  The years without a
+ * leap @month, and those whose @month is short of @day, are skipped
+ * unless @clamp has %LUNAR_DATE_CLAMP_LEAP or %LUNAR_DATE_CLAMP_DAY.  If
+ * there is no such day before the end of the supported years, the date
+ * is left as it was.
+ **/
+void		lunar_date_next_lunar		  (LunarDate *date, GDateMonth month, GDateDay day,
+		gboolean isleap, LunarDateClamp clamp, GError **error)
+{
+	g_return_if_fail(LUNAR_IS_DATE(date));
+	g_return_if_fail(month >= 1 && month <= 12);
+	g_return_if_fail(day >= 1 && day <= 30);
+
+	_cl_date_find_lunar(date, month, day, isleap, clamp, FALSE, error);
+}
+
+/**
+ * lunar_date_prev_lunar:
+ * @date: a #LunarDate
+ * @month: the lunar month, from 1 to 12.
+ * @day: the lunar day, from 1 to 30.
+ * @isleap: whether @month is a leap month.
+ * @clamp: what to do in the years without the month or the day.
+ * @error: location to store the error occuring, or %NULL to ignore errors.
+ *
+ * Like lunar_date_next_lunar(), moving the date to the last lunar @month
+ * @day on or before it.
+ **/
+void		lunar_date_prev_lunar		  (LunarDate *date, GDateMonth month, GDateDay day,
+		gboolean isleap, LunarDateClamp clamp, GError **error)
+{
+	g_return_if_fail(LUNAR_IS_DATE(date));
+	g_return_if_fail(month >= 1 && month <= 12);
+	g_return_if_fail(day >= 1 && day <= 30);
+
+	_cl_date_find_lunar(date, month, day, isleap, clamp, TRUE, error);
+}
+
+/**
+ * lunar_date_next_ganzhi:
+ * @date: a #LunarDate
+ * @pillar: the pillar to look at, not %LUNAR_DATE_PILLAR_HOUR.
+ * @ganzhi: the place of the gan-zhi in the cycle of 60, 0 being Jiazi.
+ * @error: location to store the error occuring, or %NULL to ignore errors.
+ *
+ * Moves the date to the next day whose gan-zhi of @pillar, as
+ * lunar_date_get_ganzhi() gets it, is @ganzhi, keeping the hour.  The
+ * date itself is the next one if its gan-zhi is @ganzhi, otherwise it is
+ * the first day of the year or month found.  If there is no such day
+ * before the end of the supported years, the date is left as it was.
+ **/
+void		lunar_date_next_ganzhi		  (LunarDate *date, LunarDatePillar pillar,
+		guint ganzhi, GError **error)
+{
+	g_return_if_fail(LUNAR_IS_DATE(date));
+	g_return_if_fail(pillar < LUNAR_DATE_PILLAR_HOUR);
+	g_return_if_fail(ganzhi < 60);
+
+	_cl_date_find_ganzhi(date, pillar, ganzhi, FALSE, error);
+}
+
+/**
+ * lunar_date_prev_ganzhi:
+ * @date: a #LunarDate
+ * @pillar: the pillar to look at, not %LUNAR_DATE_PILLAR_HOUR.
+ * @ganzhi: the place of the gan-zhi in the cycle of 60, 0 being Jiazi.
+ * @error: location to store the error occuring, or %NULL to ignore errors.
+ *
+ * Like lunar_date_next_ganzhi(), moving the date to the last such day on
+ * or before it, the last day of the year or month found.
+ **/
+void		lunar_date_prev_ganzhi		  (LunarDate *date, LunarDatePillar pillar,
+		guint ganzhi, GError **error)
+{
+	g_return_if_fail(LUNAR_IS_DATE(date));
+	g_return_if_fail(pillar < LUNAR_DATE_PILLAR_HOUR);
+	g_return_if_fail(ganzhi < 60);
+
+	_cl_date_find_ganzhi(date, pillar, ganzhi, TRUE, error);
+}
+
+/**
+ * lunar_date_next_zodiac:
+ * @date: a #LunarDate
+ * @zodiac: the animal, from 0 for the rat to 11 for the pig.
+ * @error: location to store the error occuring, or %NULL to ignore errors.
+ *
+ * Moves the date to the first day of the next lunar year of @zodiac,
+ * keeping the hour.  The date is left as it was if its year is one, or if
+ * there is none before the end of the supported years.
+ **/
+void		lunar_date_next_zodiac		  (LunarDate *date, guint zodiac, GError **error)
+{
+	g_return_if_fail(LUNAR_IS_DATE(date));
+	g_return_if_fail(zodiac < 12);
+
+	/* 1900 is the year of the rat */
+	_cl_date_find_year(date, 0, 12, zodiac, FALSE, error);
+}
+
+/**
+ * lunar_date_prev_zodiac:
+ * @date: a #LunarDate
+ * @zodiac: the animal, from 0 for the rat to 11 for the pig.
+ * @error: location to store the error occuring, or %NULL to ignore errors.
+ *
+ * Like lunar_date_next_zodiac(), moving the date to the last day of the
+ * last lunar year of @zodiac on or before it.
+ **/
+void		lunar_date_prev_zodiac		  (LunarDate *date, guint zodiac, GError **error)
+{
+	g_return_if_fail(LUNAR_IS_DATE(date));
+	g_return_if_fail(zodiac < 12);
+
+	_cl_date_find_year(date, 0, 12, zodiac, TRUE, error);
+}
+
+/**
+ * lunar_date_project_year:
+ * @year: the lunar year to project to.
+ * @months: (array length=n_dates): the lunar months, from 1 to 12.
+ * @days: (array length=n_dates): the lunar days, from 1 to 30.
+ * @isleap: (array length=n_dates) (allow-none): whether each month is a
+ * leap month, %NULL if none is.
+ * @n_dates: the number of dates.
+ * @clamp: what to do if a month or a day is not in @year.
+ * @julians: (out caller-allocates) (array length=n_dates): return
+ * location for the solar dates.
+ * @error: location to store the error occuring, or %NULL to ignore errors.
+ *
+ * Finds the days the lunar dates fall on in @year, for example to get
+ * this year's days of birthdays kept as lunar dates.  The dates are
+ * stored as julian days, see g_date_set_julian().  A date that is not
+ * in @year, after @clamp, is stored as 0.
+ *
+ * Return value: the number of dates found, 0 with @error set if @year
+ * is out of range.
+ **/
+guint		lunar_date_project_year		  (GDateYear year, const guint8 *months,
+		const guint8 *days, const gboolean *isleap, guint n_dates, LunarDateClamp clamp,
+		guint32 *julians, GError **error)
+{
+	gint ordinal, month_days;
+	guint i, n = 0;
+
+	g_return_val_if_fail(n_dates == 0 || (months != NULL && days != NULL && julians != NULL), 0);
+
+	if (year < BEGIN_YEAR || year >= BEGIN_YEAR + NUM_OF_YEARS)
+	{
+		g_set_error(error, LUNAR_DATE_ERROR,
+				LUNAR_DATE_ERROR_YEAR,
+				_("Year out of range."));
+		return 0;
+	}
+
+	_lunar_tables_init();
+	for (i = 0; i < n_dates; i++)
+	{
+		julians[i] = 0;
+		if (months[i] < 1 || months[i] > 12 || days[i] < 1 || days[i] > 30)
+			continue;
+		ordinal = _lunar_month_ordinal(year, months[i], isleap != NULL && isleap[i]);
+		if (ordinal < 0 && (clamp & LUNAR_DATE_CLAMP_LEAP))
+			ordinal = _lunar_month_ordinal(year, months[i], FALSE);
+		if (ordinal < 0)
+			continue;
+		month_days = _lunar_month_days(ordinal);
+		if (days[i] > month_days && !(clamp & LUNAR_DATE_CLAMP_DAY))
+			continue;
+		julians[i] = _lunar_month_start[ordinal] + MIN(days[i], month_days) - 1 + LUNAR_DAYS_JULIAN;
+		n++;
+	}
+	return n;
+}
+
+/*
+ * Adds the holidays of a day to the @n already in @result, from the
+ * holidays of its solar year: with @lunar 1 only the lunar ones, with 0
+ * all but those, with -1 all.  Returns the new count, which may be more
+ * than @max.
+ */
+static guint _cl_date_add_holidays (const LunarHoliday **result, guint n, guint max,
+		LunarHolidayDb *holidays, gint year, guint32 julian, gint lunar)
+{
+	const LunarHolidayYear *table;
+	const LunarHoliday *holiday;
+	gboolean is_lunar;
+	gint day, i;
+
+	table = _lunar_holiday_db_year(holidays, year);
+	if (table == NULL)
+		return n;
+	day = julian - table->julian;
+	for (i = table->offsets[day]; i < table->offsets[day + 1]; i++)
+	{
+		holiday = table->entries[i];
+		is_lunar = holiday->kind == LUNAR_HOLIDAY_KIND_LUNAR
+			|| holiday->kind == LUNAR_HOLIDAY_KIND_LUNAR_LAST;
+		if (lunar >= 0 && is_lunar != lunar)
+			continue;
+		if (n < max)
+			result[n] = holiday;
+		n++;
+	}
+	return n;
+}
+
+static guint _cl_date_get_holidays (LunarDate *date, const LunarHoliday **result, guint max)
+{
+	LunarDatePrivate *priv;
+	LunarHolidayDb *holidays;
+	gint ticket;
+	guint32 julian;
+	guint n;
+
+	priv = LUNAR_DATE_GET_PRIVATE (date);
+	if (priv->holidays == NULL)
+		priv->holidays = _lunar_holiday_set_get();
+	holidays = _lunar_holiday_set_acquire(priv->holidays, &ticket);
+	julian = priv->days + LUNAR_DAYS_JULIAN;
+	if (priv->solar->hour != 23)
+		n = _cl_date_add_holidays(result, 0, max, holidays, priv->solar->year, julian, -1);
+	else
+	{
+		/* the lunar day has begun, the solar one not yet */
+		n = _cl_date_add_holidays(result, 0, max, holidays,
+				priv->solar->year + (priv->solar->month == 12 && priv->solar->day == 31), julian, 1);
+		n = _cl_date_add_holidays(result, n, max, holidays, priv->solar->year, julian - 1, 0);
+	}
+	_lunar_holiday_set_release(priv->holidays, ticket);
+	return n;
+}
+
+/**
+ * lunar_date_get_holidays:
+ * @date: a #LunarDate
+ * @holidays: (out caller-allocates) (array length=max): return location
+ * for the holidays.
+ * @max: the size of @holidays.
+ *
+ * Stores the holidays and the solar term of the date in @holidays, in
+ * the order of lunar_date_get_jieri().  Nothing is allocated, the
+ * records are shared, see #LunarHoliday.  The date must be valid.
+ *
+ * Return value: the number of holidays of the date, only the first
+ * @max of them are stored if there are more.
+ **/
+guint		lunar_date_get_holidays		  (LunarDate *date, const LunarHoliday **holidays, guint max)
+{
+	g_return_val_if_fail(LUNAR_IS_DATE(date), 0);
+	g_return_val_if_fail(holidays != NULL || max == 0, 0);
+
+	return _cl_date_get_holidays(date, holidays, max);
+}
+
+/**
+ * lunar_date_get_jieri:
+ * @date: a #LunarDate
+ * @delimiter: used to join the holidays.
+ *
+ * Returns the all holiday of the date, joined with the delimiter. The date must be valid.
+ *
+ * Return value:  a newly-allocated holiday string of the date.
+ * This can be changed in  <ulink url="http://www.freedesktop.org/wiki/Specifications/basedir-spec">$XDG_CONFIG_HOME</ulink>/liblunar/hodiday.dat file,
+ * changes to it are picked up by running programs.
+ *
+ **/
+gchar*		lunar_date_get_jieri		  (LunarDate *date, const gchar *delimiter)
+{
+	GString* jieri;
+	const LunarHoliday *some[8];
+	const LunarHoliday **holidays = some;
+	guint i, n;
+
+	n = _cl_date_get_holidays(date, some, G_N_ELEMENTS(some));
+	if (n > G_N_ELEMENTS(some))
+	{
+		holidays = g_new(const LunarHoliday *, n);
+		n = MIN(n, _cl_date_get_holidays(date, holidays, n));
+	}
+
+	jieri=g_string_new("");
+	for (i = 0; i < n; i++)
+	{
+		g_string_append(jieri, delimiter);
+		g_string_append(jieri, holidays[i]->name);
+	}
+	if (holidays != some)
+		g_free(holidays);
+
+	gchar* oo = g_strdup(g_strstrip(jieri->str));
+	g_string_free(jieri, TRUE);
+	return oo;
+}
+
+/*
+ * A bounded output buffer: bytes past len are counted but not written.
+ * With @grow set the bytes go to the string instead, with no bound.
+ */
+typedef struct _FormatSink FormatSink;
+
+struct _FormatSink
+{
+	gchar	*buf;
+	gsize	 len;
+	gsize	 pos;
+	GString *grow;
+};
+
+static void _sink_append(FormatSink *sink, const gchar *str, gsize n)
+{
+	if (sink->grow != NULL)
+		g_string_append_len(sink->grow, str, n);
+	else if (sink->pos < sink->len)
+		memcpy(sink->buf + sink->pos, str, MIN(n, sink->len - sink->pos));
+	sink->pos += n;
+}
+
+static void _sink_append_str(FormatSink *sink, const gchar *str)
+{
+	_sink_append(sink, str, strlen(str));
+}
+
+static void _sink_append_int(FormatSink *sink, gint n)
+{
+	gchar tmp[16];
+
+	_sink_append(sink, tmp, g_snprintf(tmp, sizeof(tmp), "%d", n));
+}
+
+typedef enum
+{
+	FORMAT_YEAR, FORMAT_MONTH, FORMAT_DAY, FORMAT_HOUR,
+	FORMAT_year, FORMAT_month, FORMAT_day, FORMAT_hour,
+	FORMAT_NIAN, FORMAT_YUE, FORMAT_RI, FORMAT_SHI,
+	FORMAT_nian, FORMAT_yue, FORMAT_ri, FORMAT_shi,
+	FORMAT_Y60, FORMAT_M60, FORMAT_D60, FORMAT_H60,
+	FORMAT_Y8, FORMAT_M8, FORMAT_D8, FORMAT_H8,
+	FORMAT_SHENGXIAO,
+	FORMAT_JIERI
+} FormatToken;
+
+static const struct
+{
+	const gchar *name;
+	FormatToken  token;
+} format_tokens[] = {
+	{ "YEAR", FORMAT_YEAR }, { "MONTH", FORMAT_MONTH }, { "DAY", FORMAT_DAY }, { "HOUR", FORMAT_HOUR },
+	{ "year", FORMAT_year }, { "month", FORMAT_month }, { "day", FORMAT_day }, { "hour", FORMAT_hour },
+	{ "NIAN", FORMAT_NIAN }, { "YUE", FORMAT_YUE }, { "RI", FORMAT_RI }, { "SHI", FORMAT_SHI },
+	{ "nian", FORMAT_nian }, { "yue", FORMAT_yue }, { "ri", FORMAT_ri }, { "shi", FORMAT_shi },
+	{ "Y60", FORMAT_Y60 }, { "M60", FORMAT_M60 }, { "D60", FORMAT_D60 }, { "H60", FORMAT_H60 },
+	{ "Y8", FORMAT_Y8 }, { "M8", FORMAT_M8 }, { "D8", FORMAT_D8 }, { "H8", FORMAT_H8 },
+	{ "shengxiao", FORMAT_SHENGXIAO },
+	{ "jieri", FORMAT_JIERI }
+};
+
+/* Returns the token named by the "%(...)" at @p, and its length in @len, or -1. */
+static gint _format_token_lookup(const gchar *p, gsize *len)
+{
+	const gchar *end;
+	gsize n;
+	guint i;
+
+	end = strchr(p + 2, ')');
+	if (end == NULL)
+		return -1;
+	n = end - (p + 2);
+	for (i = 0; i < G_N_ELEMENTS(format_tokens); i++)
+	{
+		if (strncmp(p + 2, format_tokens[i].name, n) == 0 && format_tokens[i].name[n] == '\0')
+		{
+			*len = n + 3;
+			return format_tokens[i].token;
+		}
+	}
+	return -1;
+}
+
+static void _sink_append_ganzhi(FormatSink *sink, gint gan, gint zhi)
+{
+	_sink_append_str(sink, _(gan_list[gan]));
+	_sink_append_str(sink, _(zhi_list[zhi]));
+}
+
+static void _cl_date_format_token(LunarDate *date, FormatToken token, FormatSink *sink)
+{
+	LunarDatePrivate *priv;
+	gchar tmpbuf[128];
+	gint g, h;
+
+	priv = LUNAR_DATE_GET_PRIVATE (date);
+
+	switch (token)
+	{
+		//solar-upper case
+		case FORMAT_YEAR:
+			num_2_hanzi(priv->solar->year, tmpbuf, sizeof(tmpbuf));
+			_sink_append_str(sink, tmpbuf);
+			break;
+		case FORMAT_MONTH:
+			mday_2_hanzi(priv->solar->month, tmpbuf, sizeof(tmpbuf));
+			_sink_append_str(sink, tmpbuf);
+			break;
+		case FORMAT_DAY:
+			mday_2_hanzi(priv->solar->day, tmpbuf, sizeof(tmpbuf));
+			_sink_append_str(sink, tmpbuf);
+			break;
+		case FORMAT_HOUR:
+			mday_2_hanzi(priv->solar->hour, tmpbuf, sizeof(tmpbuf));
+			_sink_append_str(sink, tmpbuf);
+			break;
+
+		//solar-lower case
+		case FORMAT_year:
+			_sink_append_int(sink, priv->solar->year);
+			break;
+		case FORMAT_month:
+			_sink_append_int(sink, priv->solar->month);
+			break;
+		case FORMAT_day:
+			_sink_append_int(sink, priv->solar->day);
+			break;
+		case FORMAT_hour:
+			_sink_append_int(sink, priv->solar->hour);
+			break;
+
+		//lunar-upper case
+		case FORMAT_NIAN:
+			_sink_append_ganzhi(sink, priv->gan->year, priv->zhi->year);
+			break;
+		case FORMAT_YUE:
+			if (priv->lunar->isleap)
+				_sink_append_str(sink, _("R\303\271n"));
+			_sink_append_str(sink, _(lunar_month_list[priv->lunar->month-1]));
+			break;
+		case FORMAT_RI:
+			_sink_append_str(sink, _(lunar_day_list[priv->lunar->day-1]));
+			break;
+		case FORMAT_SHI:
+			_sink_append_str(sink, _(zhi_list[priv->lunar->hour/2]));
+			break;
+
+		//lunar-lower case
+		case FORMAT_nian:
+			_sink_append_int(sink, priv->lunar->year);
+			break;
+		case FORMAT_yue:
+			if (priv->lunar->isleap)
+				_sink_append(sink, "*", 1);
+			_sink_append_int(sink, priv->lunar->month);
+			break;
+		case FORMAT_ri:
+			_sink_append_int(sink, priv->lunar->day);
+			break;
+		case FORMAT_shi:
+			_sink_append_int(sink, priv->lunar->hour);
+			break;
+
+		//ganzhi
+		case FORMAT_Y60:
+			_sink_append_ganzhi(sink, priv->gan->year, priv->zhi->year);
+			break;
+		case FORMAT_M60:
+			_sink_append_ganzhi(sink, priv->gan->month, priv->zhi->month);
+			break;
+		case FORMAT_D60:
+			_sink_append_ganzhi(sink, priv->gan->day, priv->zhi->day);
+			break;
+
+		//bazi
+		case FORMAT_Y8:
+			_sink_append_ganzhi(sink, priv->gan2->year, priv->zhi2->year);
+			break;
+		case FORMAT_M8:
+			_sink_append_ganzhi(sink, priv->gan2->month, priv->zhi2->month);
+			break;
+		case FORMAT_D8:
+			_sink_append_ganzhi(sink, priv->gan2->day, priv->zhi2->day);
+			break;
+		/* 子时: 23点 --凌晨1 点前... */
+		case FORMAT_H60:
+		case FORMAT_H8:
+			h = (priv->lunar->hour+1) % 24 / 2;
+			g = (priv->gan2->day % 5 * 2 + h) % 10;
+			_sink_append_ganzhi(sink, g, h);
+			break;
+
+		//shengxiao
+		case FORMAT_SHENGXIAO:
+			_sink_append_str(sink, _(shengxiao_list[priv->zhi->year]));
+			break;
+
+		//jieri
+		case FORMAT_JIERI:
+		{
+			const LunarHoliday *holiday;
+			/* 只输出第一个节日的简称，即3个汉字或4个ascii字符
+			 * 以限制日历的示宽度
+			 * 如果不是用在日历上，请使用lunar_date_get_holidays()得到输出
+			 * */
+			if (_cl_date_get_holidays(date, &holiday, 1) > 0)
+				_sink_append_str(sink, holiday->short_name);
+			break;
+		}
+	}
+}
+
+/* Single pass over @format, copying literal text and expanding known tokens. */
+static void _cl_date_format(LunarDate *date, const gchar *format, FormatSink *sink)
+{
+	const gchar *p, *lit;
+	gsize len;
+	gint token;
+
+	lit = p = format;
+	while ((p = strstr(p, "%(")) != NULL)
+	{
+		token = _format_token_lookup(p, &len);
+		if (token < 0)
+		{
+			p += 2;
+			continue;
+		}
+		_sink_append(sink, lit, p - lit);
+		_cl_date_format_token(date, token, sink);
+		lit = p = p + len;
+	}
+	_sink_append_str(sink, lit);
+}
+
+/*
+ * Renders in one pass: a holiday reload between a sizing pass and a
+ * writing pass could change the length of %(jieri).
+ */
+static gchar* _cl_date_render(LunarDate *date, const gchar *format)
+{
+	FormatSink sink = { NULL, 0, 0, NULL };
+
+	sink.grow = g_string_sized_new(64);
+	_cl_date_format(date, format, &sink);
+	return g_string_free(sink.grow, FALSE);
+}
+
+/*
+ * Rendered strings cache.
+ *
+ * Keyed by the day number, the hour, the format, the message locale and
+ * the holiday serial.  Every entry owns its copy of the format, so evicting
+ * an entry frees everything it added.  Values are GRefStrings shared with
+ * the callers.  The cache is off until lunar_date_cache_set_size() gives
+ * it a size.
+ */
+typedef struct _FormatCacheEntry FormatCacheEntry;
+
+struct _FormatCacheEntry
+{
+	glong		 days;
+	guint		 hour;
+	gchar		*format;
+	const gchar *locale;
+	guint		 serial;
+	gchar		*value;
+	GList		 link;
+};
+
+G_LOCK_DEFINE_STATIC (format_cache);
+static gint		format_cache_max = 0;
+static GHashTable  *format_cache = NULL;
+static GQueue		format_cache_lru = G_QUEUE_INIT;
+static guint64		format_cache_hits = 0;
+static guint64		format_cache_misses = 0;
+
+static guint _format_cache_entry_hash(gconstpointer key)
+{
+	const FormatCacheEntry *e = key;
+
+	return (guint)e->days * 31 * 24 + e->hour * 131 + g_str_hash(e->format) * 2654435761u + GPOINTER_TO_UINT(e->locale) + e->serial;
 }
 
-/**
- * lunar_date_set_lunar_date:
- * @date: a #LunarDate.
- * @year: year to set.
- * @month: month to set.
- * @day: day to set.
- * @hour: hour to set.
- * @isleap: indicate whether the month is a leap month.
- * @error: location to store the error occuring, or #NULL to ignore errors.
- *
- * Sets the lunar year, month, day and the hour for a #LunarDate. If the month is a leap month, you should set the isleap to TRUE.
- **/
-void			lunar_date_set_lunar_date	  (LunarDate *date,
-		GDateYear year,
-		GDateMonth month, 
-		GDateDay day,
-		guint8 hour,
-		gboolean isleap,
-		GError **error)
+static gboolean _format_cache_entry_equal(gconstpointer a, gconstpointer b)
 {
-	GError *calc_error = NULL;
-	LunarDatePrivate *priv;
+	const FormatCacheEntry *e1 = a;
+	const FormatCacheEntry *e2 = b;
 
-	priv = LUNAR_DATE_GET_PRIVATE (date);
+	return e1->days == e2->days && e1->hour == e2->hour
+		&& e1->locale == e2->locale && e1->serial == e2->serial
+		&& strcmp(e1->format, e2->format) == 0;
+}
 
-	if (!(year>=BEGIN_YEAR && year< BEGIN_YEAR+NUM_OF_YEARS))
-	{
-		g_set_error(error, LUNAR_DATE_ERROR,
-				LUNAR_DATE_ERROR_YEAR,
-				_("Year out of range."));
-		return;
-	}
+static void _format_cache_entry_free(FormatCacheEntry *entry)
+{
+	g_ref_string_release(entry->value);
+	g_free(entry->format);
+	g_slice_free(FormatCacheEntry, entry);
+}
 
-	if (!g_date_valid_month(month))
+/* Must be called with the format_cache lock held. */
+static void _format_cache_trim(guint max)
+{
+	while (format_cache_lru.length > max)
 	{
-		g_set_error(error, LUNAR_DATE_ERROR,
-				LUNAR_DATE_ERROR_MONTH,
-				_("Month out of range."));
-		return;
-	}
+		GList *link = g_queue_pop_tail_link(&format_cache_lru);
+		FormatCacheEntry *entry = link->data;
 
-	if (hour == 24) hour = 0;
-	if (hour < 0 || hour > 23)
-	{
-		g_set_error(error, LUNAR_DATE_ERROR,
-				LUNAR_DATE_ERROR_HOUR,
-				_("Hour out of range."));
-		return;
+		g_hash_table_remove(format_cache, entry);
+		_format_cache_entry_free(entry);
 	}
+}
 
-	priv->lunar->year = year;
-	priv->lunar->month = month;
-	priv->lunar->day = day;
-	priv->lunar->hour = hour;
-	priv->lunar->isleap = isleap;
-	/* 计算公历 */
-	_cl_date_calc_solar(date, &calc_error);
-	if (calc_error != NULL)
-	{
-		g_propagate_error (error, calc_error);
-		calc_error = NULL;
-		return;
-	}
-	_cl_date_calc_ganzhi(date);
-	_cl_date_calc_bazi(date);
+/**
+ * lunar_date_cache_set_size:
+ * @max_entries: the maximum number of rendered strings to keep, 0 disables the cache.
+ *
+ * Enables the process-wide cache used by lunar_date_strftime() and
+ * lunar_date_strftime_cached(), or changes its size.  The least recently
+ * used strings are dropped first.  The cache is disabled by default.
+ **/
+void lunar_date_cache_set_size (guint max_entries)
+{
+	G_LOCK (format_cache);
+	if (format_cache == NULL)
+		format_cache = g_hash_table_new(_format_cache_entry_hash, _format_cache_entry_equal);
+	_format_cache_trim(max_entries);
+	g_atomic_int_set(&format_cache_max, MIN(max_entries, G_MAXINT));
+	G_UNLOCK (format_cache);
 }
 
 /**
- * lunar_date_get_jieri:
- * @date: a #LunarDate
- * @delimiter: used to join the holidays.
+ * lunar_date_cache_get_stats:
+ * @hits: (out) (allow-none): location for the number of cache hits, or #NULL.
+ * @misses: (out) (allow-none): location for the number of cache misses, or #NULL.
+ * @size: (out) (allow-none): location for the number of cached strings, or #NULL.
  *
- * Returns the all holiday of the date, joined with the delimiter. The date must be valid.
+ * Reports how well the cache enabled with lunar_date_cache_set_size()
+ * performs.  The counters accumulate since the process started.
+ **/
+void lunar_date_cache_get_stats (guint64 *hits, guint64 *misses, guint *size)
+{
+	G_LOCK (format_cache);
+	if (hits != NULL)
+		*hits = format_cache_hits;
+	if (misses != NULL)
+		*misses = format_cache_misses;
+	if (size != NULL)
+		*size = format_cache_lru.length;
+	G_UNLOCK (format_cache);
+}
+
+/**
+ * lunar_date_strftime_cached:
+ * @date: a #LunarDate
+ * @format: specify the output format, see lunar_date_strftime().
  *
- * Return value:  a newly-allocated holiday string of the date.
- * This can be changed in  <ulink url="http://www.freedesktop.org/wiki/Specifications/basedir-spec">$XDG_CONFIG_HOME</ulink>/liblunar/hodiday.dat file.
+ * Like lunar_date_strftime(), but returns a shared immutable string from
+ * the cache enabled with lunar_date_cache_set_size().  Without a cache the
+ * string is rendered every time.
  *
+ * Return value: (transfer full): a reference counted string, release it
+ * with g_ref_string_release(), never with g_free().
  **/
-gchar*		lunar_date_get_jieri		  (LunarDate *date, const gchar *delimiter)
+gchar* lunar_date_strftime_cached (LunarDate *date, const char *format)
 {
 	LunarDatePrivate *priv;
-	GString* jieri;
+	FormatCacheEntry key, *entry;
+	gchar *value, *str;
 
-	gint weekday, weekth;
-	gchar* str_day;
+	g_return_val_if_fail (LUNAR_IS_DATE (date), NULL);
+	g_return_val_if_fail (format != NULL, NULL);
 
-	jieri=g_string_new("");
 	priv = LUNAR_DATE_GET_PRIVATE (date);
-
-	if (priv->keyfile != NULL)
+	key.days = priv->days;
+	key.hour = priv->solar->hour;
+	key.locale = g_intern_string(g_get_language_names()[0]);
+	/* entries of reloaded holidays are never hit again and age out */
+	key.serial = _lunar_holidays_serial();
+	key.format = (gchar *) format;
+
+	G_LOCK (format_cache);
+	if (format_cache_max > 0)
 	{
-
-		if (g_key_file_has_group(priv->keyfile, "LUNAR"))
-		{
-			str_day = g_strdup_printf("%02d%02d", priv->lunar->month, priv->lunar->day);
-			if (g_key_file_has_key (priv->keyfile, "LUNAR", str_day, NULL))
-			{
-				char* freeme;
-				jieri=g_string_append(jieri, delimiter);
-				freeme = g_key_file_get_value (priv->keyfile, "LUNAR", str_day, NULL);
-				jieri=g_string_append(jieri, freeme);
-				g_free(freeme);
-			}
-			g_free(str_day);
-		}
-
-		if (g_key_file_has_group(priv->keyfile, "SOLAR"))
+		entry = g_hash_table_lookup(format_cache, &key);
+		if (entry != NULL)
 		{
-			str_day = g_strdup_printf("%02d%02d", priv->solar->month, priv->solar->day);
-			if (g_key_file_has_key (priv->keyfile, "SOLAR", str_day, NULL))
-			{
-				char *freeme;
-				jieri=g_string_append(jieri, delimiter);
-				freeme = g_key_file_get_value (priv->keyfile, "SOLAR", str_day, NULL);
-				jieri=g_string_append(jieri, freeme);
-				g_free(freeme);
-			}
-			g_free(str_day);
+			format_cache_hits++;
+			g_queue_unlink(&format_cache_lru, &entry->link);
+			g_queue_push_head_link(&format_cache_lru, &entry->link);
+			value = g_ref_string_acquire(entry->value);
+			G_UNLOCK (format_cache);
+			return value;
 		}
+		format_cache_misses++;
+	}
+	G_UNLOCK (format_cache);
 
-		weekday = get_day_of_week ( priv->solar->year, priv->solar->month, priv->solar->day);
-		weekth = get_weekth_of_month ( priv->solar->day);
-		if (g_key_file_has_group(priv->keyfile, "WEEK"))
-		{
-			str_day = g_strdup_printf("%02d%01d%01d", priv->solar->month, weekth, weekday);
-			if (g_key_file_has_key (priv->keyfile, "WEEK", str_day, NULL))
-			{
-				char *freeme;
-				jieri=g_string_append(jieri, delimiter);
-				freeme = g_key_file_get_value (priv->keyfile, "WEEK", str_day, NULL);
-				jieri=g_string_append(jieri, freeme);
-				g_free(freeme);
-			}
-			g_free(str_day);
-		}
+	str = _cl_date_render(date, format);
+	value = g_ref_string_new(str);
+	g_free(str);
 
-		//jie2qi4
-		static char str_jq[24][20] = {'9'};
-		int i;
-		char yc[5] = {str_jq[0][0], str_jq[0][1], str_jq[0][2], str_jq[0][3], '\0'};
-		if(atoi(yc) != priv->solar->year)
-		{
-			for(i=0; i<24; i++)
-			{
-				year_jieqi(priv->solar->year, i, str_jq[i]);
-			}
-		}
-		str_day = g_strdup_printf("%04d%02d%02d", priv->solar->year, priv->solar->month, priv->solar->day);
-		for (i=0; i<24; i++)
-		{
-			gchar** jq_day;
-			jq_day = g_strsplit(str_jq[i], " ", 2);
-			if (g_ascii_strcasecmp(jq_day[0], str_day) == 0)
-			{
-				jieri=g_string_append(jieri, delimiter);
-				jieri=g_string_append(jieri, jq_day[1]);
-			}
-			g_strfreev(jq_day);
-		}
-		g_free(str_day);
+	G_LOCK (format_cache);
+	if (format_cache_max > 0 && g_hash_table_lookup(format_cache, &key) == NULL)
+	{
+		entry = g_slice_new0(FormatCacheEntry);
+		entry->days = key.days;
+		entry->hour = key.hour;
+		entry->locale = key.locale;
+		entry->serial = key.serial;
+		entry->format = g_strdup(format);
+		entry->value = g_ref_string_acquire(value);
+		entry->link.data = entry;
+		g_hash_table_insert(format_cache, entry, entry);
+		g_queue_push_head_link(&format_cache_lru, &entry->link);
+		_format_cache_trim(format_cache_max);
 	}
+	G_UNLOCK (format_cache);
 
-	gchar* oo = g_strdup(g_strstrip(jieri->str));
-	g_string_free(jieri, TRUE);
-	return oo;
+	return value;
 }
 
 /**
@@ -488,262 +1885,172 @@ gchar*		lunar_date_get_jieri		  (LunarDate *date, const gchar *delimiter)
  **/
 gchar* lunar_date_strftime (LunarDate *date, const char *format)
 {
-	gchar *s, *tmp;
-	gchar* t1;
-	gchar tmpbuf[32];
-	LunarDatePrivate *priv;
-
-	gchar* str = g_strdup(format);
-
-	//GString *str = g_string_new(format);
-	priv = LUNAR_DATE_GET_PRIVATE (date);
+	gchar *cached, *str;
 
-	//solar-upper case
-	if (strstr(format, "%(YEAR)") != NULL)
-	{
-		num_2_hanzi(priv->solar->year, tmpbuf, sizeof(tmpbuf));
-		t1 = str_replace(str, "\%\\(YEAR\\)", tmpbuf);
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
-	if (strstr(format, "%(MONTH)") != NULL)
-	{
-		mday_2_hanzi(priv->solar->month, tmpbuf, sizeof(tmpbuf));
-		t1 = str_replace(str, "\%\\(MONTH\\)", tmpbuf);
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
-	if (strstr(format, "%(DAY)") != NULL)
-	{
-		mday_2_hanzi(priv->solar->day, tmpbuf, sizeof(tmpbuf));
-		t1 = str_replace(str, "\%\\(DAY\\)", tmpbuf);
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
-	if (strstr(format, "%(HOUR)") != NULL)
-	{
-		mday_2_hanzi(priv->solar->hour, tmpbuf, sizeof(tmpbuf));
-		t1 = str_replace(str, "\%\\(HOUR\\)", tmpbuf);
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
+	g_return_val_if_fail (format != NULL, NULL);
 
-	//solar-lower case
-	if (strstr(format, "%(year)") != NULL)
-	{
-		tmp = g_strdup_printf("%d", priv->solar->year);
+	if (g_atomic_int_get(&format_cache_max) == 0)
+		return _cl_date_render(date, format);
 
-		t1 = str_replace(str, "\%\\(year\\)", tmp);
-		g_free(tmp);
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
-	if (strstr(format, "%(month)") != NULL)
-	{
-		tmp = g_strdup_printf("%d", priv->solar->month);
-		t1 = str_replace(str, "\%\\(month\\)", tmp);
-		g_free(tmp);
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
-	if (strstr(format, "%(day)") != NULL)
-	{
-		tmp = g_strdup_printf("%d", priv->solar->day);
-		t1 = str_replace(str, "\%\\(day\\)", tmp);
-		g_free(tmp);
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
-	if (strstr(format, "%(hour)") != NULL)
-	{
-		tmp = g_strdup_printf("%d", priv->solar->hour);
-		t1 = str_replace(str, "\%\\(hour\\)", tmp);
-		g_free(tmp);
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
+	cached = lunar_date_strftime_cached(date, format);
+	str = g_strdup(cached);
+	g_ref_string_release(cached);
+	return str;
+}
 
-	//lunar-upper case
-	if (strstr(format, "%(NIAN)") != NULL)
-	{
-		tmp = g_strdup_printf("%s%s", _(gan_list[priv->gan->year]), _(zhi_list[priv->zhi->year]));
-		t1 = str_replace(str, "\%\\(NIAN\\)", tmp);
-		g_free(tmp);
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
-	if (strstr(format, "%(YUE)") != NULL)
-	{
-		if (priv->lunar->isleap)
-			tmp = g_strdup_printf("%s%s", _("R\303\271n"), _(lunar_month_list[priv->lunar->month-1]));
-		else
-			tmp = g_strdup_printf("%s", _(lunar_month_list[priv->lunar->month-1]));
-		t1 = str_replace(str, "\%\\(YUE\\)", tmp);
-		g_free(tmp);
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
-	if (strstr(format, "%(RI)") != NULL)
-	{
-		t1 = str_replace(str, "\%\\(RI\\)", _(lunar_day_list[priv->lunar->day-1]));
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
-	if (strstr(format, "%(SHI)") != NULL)
+static gsize _cl_date_strftime_batch(LunarDate *date,
+		const GDate *dates,
+		const GDate *start,
+		guint n_dates,
+		guint8 hour,
+		const gchar *format,
+		gchar *buffer,
+		gsize buffer_len,
+		guint32 *offsets,
+		GError **error)
+{
+	FormatSink sink;
+	GDate day;
+	guint i;
+
+	sink.buf = buffer;
+	sink.len = (buffer != NULL) ? buffer_len : 0;
+	sink.pos = 0;
+	sink.grow = NULL;
+	if (start != NULL)
+		day = *start;
+
+	for (i = 0; i < n_dates; i++)
 	{
-		t1 = str_replace(str, "\%\\(SHI\\)", _(zhi_list[priv->lunar->hour/2]));
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
+		GError *calc_error = NULL;
+		const GDate *d;
 
-	//lunar-lower case
-	if (strstr(format, "%(nian)") != NULL)
-	{
-		tmp = g_strdup_printf("%d", priv->lunar->year);
-		t1 = str_replace(str, "\%\\(nian\\)", tmp);
-		g_free(tmp);
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
-	if (strstr(format, "%(yue)") != NULL)
-	{
-		if (priv->lunar->isleap)
-			tmp = g_strdup_printf("*%d", priv->lunar->month);
+		if (start != NULL)
+		{
+			if (i > 0)
+				g_date_add_days(&day, 1);
+			d = &day;
+		}
 		else
-			tmp = g_strdup_printf("%d", priv->lunar->month);
-		t1 = str_replace(str, "\%\\(yue\\)", tmp);
-		g_free(tmp);
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
-	if (strstr(format, "%(ri)") != NULL)
-	{
-		tmp = g_strdup_printf("%d", priv->lunar->day);
-		t1 = str_replace(str, "\%\\(ri\\)", tmp);
-		g_free(tmp);
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
-	if (strstr(format, "%(shi)") != NULL)
-	{
-		tmp = g_strdup_printf("%d", priv->lunar->hour);
-		t1 = str_replace(str, "\%\\(shi\\)", tmp);
-		g_free(tmp);
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
-
-	//ganzhi
-	if (strstr(format, "%(Y60)") != NULL)
-	{
-		tmp = g_strdup_printf("%s%s", _(gan_list[priv->gan->year]), _(zhi_list[priv->zhi->year]));
-		t1 = str_replace(str, "\%\\(Y60\\)", tmp);
-		g_free(tmp);
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
-	if (strstr(format, "%(M60)") != NULL)
-	{
-		tmp = g_strdup_printf("%s%s", _(gan_list[priv->gan->month]), _(zhi_list[priv->zhi->month]));
-		t1 = str_replace(str, "\%\\(M60\\)", tmp);
-		g_free(tmp);
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
-	if (strstr(format, "%(D60)") != NULL)
-	{
-		tmp = g_strdup_printf("%s%s", _(gan_list[priv->gan->day]), _(zhi_list[priv->zhi->day]));
-		t1 = str_replace(str, "\%\\(D60\\)", tmp);
-		g_free(tmp);
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
-	if (strstr(format, "%(H60)") != NULL)
-	{
-		int g=0, h=0;
-		h = (priv->lunar->hour+1) % 24 / 2;
-		g = (priv->gan2->day % 5 * 2 + h) % 10;
-		tmp = g_strdup_printf("%s%s", _(gan_list[g]), _(zhi_list[h]));
-		t1 = str_replace(str, "\%\\(H60\\)", tmp);
-		g_free(tmp);
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
-
-	//bazi
-	if (strstr(format, "%(Y8)") != NULL)
-	{
-		tmp = g_strdup_printf("%s%s", _(gan_list[priv->gan2->year]), _(zhi_list[priv->zhi2->year]));
-		t1 = str_replace(str, "\%\\(Y8\\)", tmp);
-		g_free(tmp);
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
-	if (strstr(format, "%(M8)") != NULL)
-	{
-		tmp = g_strdup_printf("%s%s", _(gan_list[priv->gan2->month]), _(zhi_list[priv->zhi2->month]));
-		t1 = str_replace(str, "\%\\(M8\\)", tmp);
-		g_free(tmp);
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
-	if (strstr(format, "%(D8)") != NULL)
-	{
-		tmp = g_strdup_printf("%s%s", _(gan_list[priv->gan2->day]), _(zhi_list[priv->zhi2->day]));
-		t1 = str_replace(str, "\%\\(D8\\)", tmp);
-		g_free(tmp);
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
-	/* 子时: 23点 --凌晨1 点前... */
-	if (strstr(format, "%(H8)") != NULL)
-	{
-		int g=0, h=0;
-		h = (priv->lunar->hour+1) % 24 / 2;
-		g = (priv->gan2->day % 5 * 2 + h) % 10;
-		tmp = g_strdup_printf("%s%s", _(gan_list[g]), _(zhi_list[h]));
-		t1 = str_replace(str, "\%\\(H8\\)", tmp);
-		g_free(tmp);
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
-
-	//shengxiao
-	if (strstr(format, "%(shengxiao)") != NULL)
-	{
-		t1 = str_replace(str, "\%\\(shengxiao\\)", _(shengxiao_list[priv->zhi->year]));
-		g_free(str); str=g_strdup(t1); g_free(t1);
-	}
+			d = &dates[i];
 
-	//jieri
-	if (strstr(format, "%(jieri)") != NULL)
-	{
-		gchar bufs[128];
-		gchar *tmp;
-		tmp = lunar_date_get_jieri(date, " ");
-		/* 将格式化后的输出限制为3个汉字或4个ascii字符
-		 * 以限制日历的示宽度
-		 * 如果不是用在日历上，请使用lunar_date_get_jieri()得到输出
-		 * */
-		if (strstr(tmp, " " ) != NULL)
+		if (!g_date_valid(d))
 		{
-			char** buf = g_strsplit(tmp, " ", -1);
-			if (g_utf8_validate(*buf, -1, NULL))
-				g_utf8_strncpy(bufs, *buf, 3);
-			else
-			{
-				strncpy(bufs, *buf, 4);
-				bufs[4]= '\0';
-			}
-			g_strfreev(buf);
+			g_set_error(error, LUNAR_DATE_ERROR,
+					LUNAR_DATE_ERROR_DAY,
+					_("Invalid date at index %u."), i);
+			return 0;
 		}
-		else
+		lunar_date_set_solar_date(date, g_date_get_year(d), g_date_get_month(d), g_date_get_day(d), hour, &calc_error);
+		if (calc_error != NULL)
+		{
+			g_propagate_error (error, calc_error);
+			return 0;
+		}
+		if (offsets != NULL)
+			offsets[i] = sink.pos;
+		_cl_date_format(date, format, &sink);
+		/* checked after every string so offsets[n_dates] cannot wrap either */
+		if (sink.pos > G_MAXUINT32)
 		{
-			if (g_utf8_validate(tmp, -1, NULL))
-				g_utf8_strncpy(bufs, tmp, 3);
-			else
-			{
-				strncpy(bufs, tmp, 4);
-				bufs[4]= '\0';
-			}
+			g_set_error(error, LUNAR_DATE_ERROR,
+					LUNAR_DATE_ERROR_INTERNAL,
+					_("Batch output exceeds 4 GiB."));
+			return 0;
 		}
-		g_free(tmp);
-		t1 = str_replace(str, "\%\\(jieri\\)", bufs);
-		g_free(str); str=g_strdup(t1); g_free(t1);
 	}
+	if (offsets != NULL)
+		offsets[n_dates] = sink.pos;
+	return sink.pos;
+}
 
-	return str;
-	//return g_string_free(str, FALSE);
+/**
+ * lunar_date_strftime_batch:
+ * @date: a #LunarDate used as the conversion context.
+ * @dates: (array length=n_dates): the solar dates to render.
+ * @n_dates: number of elements in @dates.
+ * @hour: hour used for every date.
+ * @format: output format, see lunar_date_strftime().
+ * @buffer: (allow-none): caller-owned arena receiving the rendered strings.
+ * @buffer_len: size of @buffer in bytes.
+ * @offsets: (allow-none) (array): location for @n_dates + 1 offsets.
+ * @error: location to store the error occuring, or #NULL to ignore errors.
+ *
+ * Renders every date of @dates with @format into one contiguous arena.
+ * The strings are written back to back without terminators: string i
+ * occupies bytes offsets[i] up to offsets[i+1] of @buffer, the same
+ * layout Arrow uses for string columns.
+ *
+ * Nothing is written past @buffer_len, but @offsets always describes the
+ * complete layout, so a caller may pass a #NULL buffer first and allocate
+ * exactly the returned size.  @date is left set to the last date.
+ *
+ * Return value: the number of bytes the whole batch needs, or 0 with
+ * @error set if a date can not be converted.
+ **/
+gsize lunar_date_strftime_batch (LunarDate *date,
+		const GDate *dates,
+		guint n_dates,
+		guint8 hour,
+		const gchar *format,
+		gchar *buffer,
+		gsize buffer_len,
+		guint32 *offsets,
+		GError **error)
+{
+	g_return_val_if_fail (date != NULL, 0);
+	g_return_val_if_fail (dates != NULL || n_dates == 0, 0);
+	g_return_val_if_fail (format != NULL, 0);
+
+	return _cl_date_strftime_batch(date, dates, NULL, n_dates, hour, format, buffer, buffer_len, offsets, error);
 }
 
 /**
- * lunar_date_free:
- * @date: a #LunarDate
+ * lunar_date_strftime_range:
+ * @date: a #LunarDate used as the conversion context.
+ * @start: the first solar date to render.
+ * @n_days: number of consecutive days to render.
+ * @hour: hour used for every date.
+ * @format: output format, see lunar_date_strftime().
+ * @buffer: (allow-none): caller-owned arena receiving the rendered strings.
+ * @buffer_len: size of @buffer in bytes.
+ * @offsets: (allow-none) (array): location for @n_days + 1 offsets.
+ * @error: location to store the error occuring, or #NULL to ignore errors.
+ *
+ * Like lunar_date_strftime_batch(), for the @n_days consecutive days
+ * starting at @start.
  *
- * Frees a #LunarDate returned from lunar_date_new().
+ * Return value: the number of bytes the whole range needs, or 0 with
+ * @error set if a date can not be converted.
  **/
-void			lunar_date_free					  (LunarDate *date)
+gsize lunar_date_strftime_range (LunarDate *date,
+		const GDate *start,
+		guint n_days,
+		guint8 hour,
+		const gchar *format,
+		gchar *buffer,
+		gsize buffer_len,
+		guint32 *offsets,
+		GError **error)
+{
+	g_return_val_if_fail (date != NULL, 0);
+	g_return_val_if_fail (start != NULL, 0);
+	g_return_val_if_fail (format != NULL, 0);
+
+	return _cl_date_strftime_batch(date, NULL, start, n_days, hour, format, buffer, buffer_len, offsets, error);
+}
+
+/*
+ * Frees the date however its last reference goes, lunar_date_free() or
+ * g_object_unref() from the bindings, so the holidays go back to the
+ * registry either way.
+ */
+static void
+lunar_date_finalize (GObject *object)
 {
-	g_return_if_fail (date != NULL);
 	LunarDatePrivate *priv;
 
-	priv = LUNAR_DATE_GET_PRIVATE (date);
+	priv = LUNAR_DATE_GET_PRIVATE (LUNAR_DATE (object));
 
 	g_free(priv->solar);
 	g_free(priv->lunar);
@@ -752,7 +2059,24 @@ void			lunar_date_free					  (LunarDate *date)
 	g_free(priv->zhi);
 	g_free(priv->gan2);
 	g_free(priv->zhi2);
-	g_key_file_free(priv->keyfile);
+	if (priv->holidays != NULL)
+		_lunar_holiday_set_unref(priv->holidays);
+
+	G_OBJECT_CLASS (lunar_date_parent_class)->finalize (object);
+}
+
+/**
+ * lunar_date_free:
+ * @date: a #LunarDate
+ *
+ * Frees a #LunarDate returned from lunar_date_new().  This drops the
+ * reference lunar_date_new() returned, like g_object_unref().
+ **/
+void			lunar_date_free					  (LunarDate *date)
+{
+	g_return_if_fail (LUNAR_IS_DATE (date));
+
+	g_object_unref (date);
 }
 
 static void _cl_date_calc_lunar(LunarDate *date, GError **error)
@@ -860,57 +2184,22 @@ static void _cl_date_calc_bazi(LunarDate *date)
 /* Compute offset days of a lunar date from the beginning of the table */
 static void _date_calc_days_since_lunar_year (LunarDate *date, GError **error)
 {
-	int year, i, m, leap_month;
 	LunarDatePrivate *priv;
 
 	priv = LUNAR_DATE_GET_PRIVATE (date);
-
-	priv->days = 0;
-	year = priv->lunar->year - first_lunar_date.year;
-	for (i=0; i<year; i++)
-		priv->days += priv->lunar_year_days[i];
-
-	leap_month = _cl_date_make_lunar_month_days(date, year);
-	if ((priv->lunar->isleap) && (leap_month!=priv->lunar->month))
-	{
-		g_set_error(error, LUNAR_DATE_ERROR,
-				LUNAR_DATE_ERROR_LEAP,
-				_("%d is not a leap month in year %d.\n"), 
-				priv->lunar->month, priv->lunar->year);
-		return;
-	}
-	for (m=1; m<priv->lunar->month; m++)
-		priv->days+= priv->lunar_month_days[m];
-	if (leap_month 
-			&& ((priv->lunar->month>leap_month) 
-				|| (priv->lunar->isleap && (priv->lunar->month==leap_month))
-			   ))
-		priv->days += priv->lunar_month_days[m++];
-	priv->days += priv->lunar->day - 1;
-
-	if (priv->lunar->day > priv->lunar_month_days[m]) 
-	{
-		g_set_error(error, LUNAR_DATE_ERROR,
-				LUNAR_DATE_ERROR_DAY,
-				_("Day out of range: \"%d\""),
-				priv->lunar->day);
-		return;
-	}
+	priv->days = _lunar_to_days(priv->lunar->year, priv->lunar->month,
+			priv->lunar->day, priv->lunar->isleap, error);
 }
 
 static void _cl_date_days_to_lunar (LunarDate *date, GError **error)
 {
-	int i, m, nYear, leap_month;
+	gint year, month, day;
+	gboolean isleap;
 	LunarDatePrivate *priv;
 
 	priv = LUNAR_DATE_GET_PRIVATE (date);
 
-	glong offset = priv->days;
-	for (i=0; i<NUM_OF_YEARS && offset > 0; i++)
-		offset -= priv->lunar_year_days[i];
-	if (offset <0)
-		offset += priv->lunar_year_days[--i];
-	if (i==NUM_OF_YEARS) 
+	if (!_lunar_from_days(priv->days, &year, &month, &day, &isleap))
 	{
 		g_set_error(error, LUNAR_DATE_ERROR,
 				LUNAR_DATE_ERROR_DAY,
@@ -918,28 +2207,10 @@ static void _cl_date_days_to_lunar (LunarDate *date, GError **error)
 				priv->solar->year);
 		return;
 	}
-	priv->lunar->year = i + first_lunar_date.year;
-
-	leap_month = _cl_date_make_lunar_month_days(date, i);
-	for (m=1; m<=NUM_OF_MONTHS && offset >0; m++)
-		offset -= priv->lunar_month_days[m];
-	if (offset <0)
-		offset += priv->lunar_month_days[--m];
-
-	priv->lunar->isleap = FALSE;	/* don't know leap or not yet */
-
-	if (leap_month>0)	/* has leap month */
-	{
-		/* if preceeding month number is the leap month,
-		   this month is the actual extra leap month */
-		priv->lunar->isleap = (gboolean)(leap_month == (m - 1));
-
-		/* month > leap_month is off by 1, so adjust it */
-		if (m > leap_month) --m;
-	}
-
-	priv->lunar->month = m;
-	priv->lunar->day = offset + 1;
+	priv->lunar->year = year;
+	priv->lunar->month = month;
+	priv->lunar->day = day;
+	priv->lunar->isleap = isleap;
 }
 
 static void _cl_date_days_to_solar(LunarDate *date, GError **error)
@@ -1004,81 +2275,6 @@ static void _cl_date_days_to_solar(LunarDate *date, GError **error)
 	}
 }
 
-static void _cl_date_make_all_lunar_data(LunarDate *date)
-{
-	gint year, i, leap;
-	long code;
-	LunarDatePrivate *priv;
-
-	priv = LUNAR_DATE_GET_PRIVATE (date);
-
-	for (year = 0; year < NUM_OF_YEARS; year++)
-	{
-		code = years_info[year];
-		leap = code & 0xf;
-		priv->lunar_year_days[year] = 0;
-		if (leap != 0)
-		{
-			i = (code >> 16) & 0x1;
-			priv->lunar_year_days[year] += days_in_lunar_month[i];
-		}
-		code >>= 4;
-		for (i = 0; i < NUM_OF_MONTHS-1; i++)
-		{
-			priv->lunar_year_days[year] += days_in_lunar_month[code&0x1];
-			code >>= 1;
-		}
-		priv->lunar_year_months[year] = 12;
-		if (leap != 0) 
-			priv->lunar_year_months[year]++;
-	}
-}
-
-/* Compute the days of each month in the given lunar year */
-static gint _cl_date_make_lunar_month_days(LunarDate *date, gint year)
-{
-	int i, leap_month;
-	long code;
-	LunarDatePrivate *priv;
-
-	priv = LUNAR_DATE_GET_PRIVATE (date);
-
-	code = years_info[year];
-	leap_month = code & 0xf;
-	code >>= 4;
-	if (leap_month == 0)
-	{
-		priv->lunar_month_days[NUM_OF_MONTHS] = 0;
-		for (i = NUM_OF_MONTHS-1; i >= 1; i--)
-		{
-			priv->lunar_month_days[i] = days_in_lunar_month[code&0x1];
-			code >>= 1;
-		}
-	}
-	else
-	{
-		/* 
-		   There is a leap month (run4 yue4) L in this year.
-		   mday[1] contains the number of days in the 1-st month;
-		   mday[L] contains the number of days in the L-th month;
-		   mday[L+1] contains the number of days in the L-th leap month;
-		   mday[L+2] contains the number of days in the L+1 month, etc.
-
-		   cf. years_info[]: info about the leap month is encoded differently.
-		   */
-		i = (years_info[year] >> 16) & 0x1;
-		priv->lunar_month_days[leap_month+1] = days_in_lunar_month[i];
-		for (i = NUM_OF_MONTHS; i >= 1; i--)
-		{
-			if (i == leap_month+1) 
-				i--;
-			priv->lunar_month_days[i] = days_in_lunar_month[code&0x1];
-			code >>= 1;
-		}
-	}
-	return leap_month;
-}
-
 /* Compare two dates and return <,=,> 0 if the 1st is <,=,> the 2nd */
 static gint _cl_date_get_bazi_lunar (LunarDate *date)
 {
@@ -1115,7 +2311,7 @@ static gint _cl_date_get_bazi_lunar (LunarDate *date)
 	return(flag==0);
 }
 
-static void lunar_date_init_i18n(void)
+void _lunar_date_init_i18n(void)
 {
   static gboolean _lunar_calendar_gettext_initialized = FALSE;
 
@@ -26,6 +26,7 @@
 #define __LUNAR_DATE_H__  1
 
 #include	<glib-object.h>
+#include	<lunar-date/lunar-holiday.h>
 
 G_BEGIN_DECLS
 
@@ -41,6 +42,8 @@ G_BEGIN_DECLS
 typedef struct _LunarDate			  LunarDate;
 typedef struct _LunarDateClass		  LunarDateClass;
 typedef struct _LunarDatePrivate	  LunarDatePrivate;
+typedef struct _LunarDayInfo		  LunarDayInfo;
+typedef struct _LunarYearInfo		  LunarYearInfo;
 
 //typedef guint8	GDateHour;
 
@@ -79,6 +82,117 @@ typedef enum
 	LUNAR_DATE_ERROR_LEAP
 } LunarDateError;
 
+/**
+ * LunarDatePillar:
+ * @LUNAR_DATE_PILLAR_YEAR: the gan-zhi of the year.
+ * @LUNAR_DATE_PILLAR_MONTH: the gan-zhi of the month.
+ * @LUNAR_DATE_PILLAR_DAY: the gan-zhi of the day.
+ * @LUNAR_DATE_PILLAR_HOUR: the gan-zhi of the hour.
+ *
+ * The four pillars of a date, see lunar_date_get_ganzhi().
+ */
+typedef enum
+{
+	LUNAR_DATE_PILLAR_YEAR,
+	LUNAR_DATE_PILLAR_MONTH,
+	LUNAR_DATE_PILLAR_DAY,
+	LUNAR_DATE_PILLAR_HOUR
+} LunarDatePillar;
+
+/**
+ * LunarDateClamp:
+ * @LUNAR_DATE_CLAMP_NONE: fail with an error.
+ * @LUNAR_DATE_CLAMP_DAY: move day 30 of a month that has 29 days to day
+ * 29.
+ * @LUNAR_DATE_CLAMP_LEAP: move a leap month the year does not have to the
+ * month of the same number.
+ *
+ * What to do when a lunar date moved to another month or year does not
+ * exist there.
+ */
+typedef enum
+{
+	LUNAR_DATE_CLAMP_NONE = 0,
+	LUNAR_DATE_CLAMP_DAY = 1 << 0,
+	LUNAR_DATE_CLAMP_LEAP = 1 << 1
+} LunarDateClamp;
+
+/**
+ * LunarDayInfo:
+ * @solar_year: the solar year.
+ * @solar_month: the solar month.
+ * @solar_day: the solar day.
+ * @hour: the hour.
+ * @lunar_year: the lunar year.
+ * @lunar_month: the lunar month, from 1 to 12.
+ * @lunar_day: the lunar day, from 1 to 30.
+ * @lunar_isleap: whether @lunar_month is a leap month.
+ * @ganzhi: the gan-zhi of each #LunarDatePillar, see lunar_date_get_ganzhi().
+ * @bazi: the gan-zhi of each #LunarDatePillar, see lunar_date_get_bazi().
+ * @zodiac: the zodiac animal of the lunar year, see lunar_date_get_zodiac().
+ * @days: the day number, see lunar_date_get_days().
+ *
+ * All of a date in numbers, as lunar_date_get_info() returns it.
+ */
+struct _LunarDayInfo
+{
+	GDateYear	solar_year;
+	GDateMonth	solar_month;
+	GDateDay	solar_day;
+	guint8		hour;
+	GDateYear	lunar_year;
+	guint8		lunar_month;
+	guint8		lunar_day;
+	gboolean	lunar_isleap;
+	guint8		ganzhi[4];
+	guint8		bazi[4];
+	guint8		zodiac;
+	glong		days;
+};
+
+/**
+ * LunarYearInfo:
+ * @year: the lunar year.
+ * @julian: the solar date of the first day of the year, as returned by
+ * g_date_get_julian().
+ * @n_days: the number of days of the year.
+ * @n_months: the number of months, 12, or 13 with a leap month.
+ * @leap_month: the month the leap month repeats, 0 if there is none.
+ * @month_days: the days of each of the @n_months months, in order, the
+ * leap month right after the month it repeats.
+ * @ganzhi: the gan-zhi of the year, see lunar_date_get_ganzhi().
+ * @zodiac: the zodiac animal of the year, see lunar_date_get_zodiac().
+ * @terms: the solar dates of the 24 solar terms of the solar year
+ * @year, from Xiaohan, as returned by g_date_get_julian().
+ *
+ * A lunar year in numbers, as lunar_year_get_info() returns it.
+ */
+struct _LunarYearInfo
+{
+	GDateYear	year;
+	guint32		julian;
+	guint16		n_days;
+	guint8		n_months;
+	guint8		leap_month;
+	guint8		month_days[13];
+	guint8		ganzhi;
+	guint8		zodiac;
+	guint32		terms[24];
+};
+
+/**
+ * LUNAR_DATE_PACK:
+ * @year: the lunar year.
+ * @month: the lunar month, from 1 to 12.
+ * @isleap: whether @month is a leap month.
+ * @day: the lunar day, from 1 to 30.
+ *
+ * The lunar_date_pack() of a lunar date without the hour, to build the
+ * bounds of a range of packed dates.
+ */
+#define LUNAR_DATE_PACK(year, month, isleap, day) \
+	((guint32) (((year) << 15) | (((month) * 2 + ((isleap) ? 1 : 0)) << 10) | ((day) << 5)))
+
 GQuark lunar_date_error_quark (void);
 
 GType	   lunar_date_get_type			 (void) G_GNUC_CONST;
@@ -96,10 +210,129 @@ void		lunar_date_set_lunar_date	  (LunarDate *date,
 											guint8 hour,
 											gboolean isleap,
 											GError **error);
+void		lunar_date_error_set		  (GError **error,
+											LunarDateError code);
+gboolean	lunar_date_validate_solar	  (GDateYear year,
+											GDateMonth month,
+											GDateDay day,
+											guint8 hour,
+											LunarDateError *code);
+gboolean	lunar_date_validate_lunar	  (GDateYear year,
+											GDateMonth month,
+											GDateDay day,
+											guint8 hour,
+											gboolean isleap,
+											LunarDateError *code);
+gboolean	lunar_date_try_set_solar_date (LunarDate *date,
+											GDateYear year,
+											GDateMonth month,
+											GDateDay day,
+											guint8 hour,
+											LunarDateError *code);
+gboolean	lunar_date_try_set_lunar_date (LunarDate *date,
+											GDateYear year,
+											GDateMonth month,
+											GDateDay day,
+											guint8 hour,
+											gboolean isleap,
+											LunarDateError *code);
+GDateYear	lunar_date_get_lunar_year	  (LunarDate *date);
+guint		lunar_date_get_lunar_month	  (LunarDate *date);
+guint		lunar_date_get_lunar_day	  (LunarDate *date);
+gboolean	lunar_date_get_lunar_isleap	  (LunarDate *date);
+guint		lunar_date_get_ganzhi		  (LunarDate *date,
+											LunarDatePillar pillar);
+guint		lunar_date_get_bazi			  (LunarDate *date,
+											LunarDatePillar pillar);
+guint		lunar_date_get_zodiac		  (LunarDate *date);
+glong		lunar_date_get_days			  (LunarDate *date);
+void		lunar_date_get_info			  (LunarDate *date,
+											LunarDayInfo *info);
+gboolean	lunar_year_get_info			  (GDateYear year,
+											LunarYearInfo *info);
+guint32		lunar_date_pack				  (LunarDate *date,
+											gboolean with_hour);
+void		lunar_date_unpack			  (LunarDate *date,
+											guint32 packed,
+											GError **error);
+void		lunar_date_add_days			  (LunarDate *date,
+											glong n_days,
+											GError **error);
+void		lunar_date_add_months		  (LunarDate *date,
+											gint n_months,
+											LunarDateClamp clamp,
+											GError **error);
+void		lunar_date_add_years		  (LunarDate *date,
+											gint n_years,
+											LunarDateClamp clamp,
+											GError **error);
+glong		lunar_date_days_between		  (LunarDate *date1,
+											LunarDate *date2);
+void		lunar_date_next_lunar		  (LunarDate *date,
+											GDateMonth month,
+											GDateDay day,
+											gboolean isleap,
+											LunarDateClamp clamp,
+											GError **error);
+void		lunar_date_prev_lunar		  (LunarDate *date,
+											GDateMonth month,
+											GDateDay day,
+											gboolean isleap,
+											LunarDateClamp clamp,
+											GError **error);
+void		lunar_date_next_ganzhi		  (LunarDate *date,
+											LunarDatePillar pillar,
+											guint ganzhi,
+											GError **error);
+void		lunar_date_prev_ganzhi		  (LunarDate *date,
+											LunarDatePillar pillar,
+											guint ganzhi,
+											GError **error);
+void		lunar_date_next_zodiac		  (LunarDate *date,
+											guint zodiac,
+											GError **error);
+void		lunar_date_prev_zodiac		  (LunarDate *date,
+											guint zodiac,
+											GError **error);
+guint		lunar_date_project_year		  (GDateYear year,
+											const guint8 *months,
+											const guint8 *days,
+											const gboolean *isleap,
+											guint n_dates,
+											LunarDateClamp clamp,
+											guint32 *julians,
+											GError **error);
 gchar*		lunar_date_get_jieri		  (LunarDate *date, const gchar *delimiter);
+guint		lunar_date_get_holidays		  (LunarDate *date,
+											const LunarHoliday **holidays,
+											guint max);
 gchar*		lunar_date_strftime			  (LunarDate *date, const char *format);
+gchar*		lunar_date_strftime_cached	  (LunarDate *date, const char *format);
+gsize		lunar_date_strftime_batch	  (LunarDate *date,
+											const GDate *dates,
+											guint n_dates,
+											guint8 hour,
+											const gchar *format,
+											gchar *buffer,
+											gsize buffer_len,
+											guint32 *offsets,
+											GError **error);
+gsize		lunar_date_strftime_range	  (LunarDate *date,
+											const GDate *start,
+											guint n_days,
+											guint8 hour,
+											const gchar *format,
+											gchar *buffer,
+											gsize buffer_len,
+											guint32 *offsets,
+											GError **error);
 void		lunar_date_free				  (LunarDate *date);
 
+void		lunar_date_cache_set_size	  (guint max_entries);
+void		lunar_date_cache_get_stats	  (guint64 *hits,
+											guint64 *misses,
+											guint *size);
+
 G_END_DECLS
 
 #endif /*__LUNAR_DATE_H__ */
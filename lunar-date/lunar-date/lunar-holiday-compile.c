@@ -0,0 +1,67 @@
+/* vi: set sw=4 ts=4: */
+/*
+ * lunar-holiday-compile.c: This file is part of liblunar.
+ *
+ * Copyright (C) 2009-2011 yetist <yetist@gmail.com>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * */
+
+/*
+ * Compiles holiday files into the binary format read by liblunar:
+ *
+ *	 lunar-holiday-compile INPUT... OUTPUT
+ *
+ * Later inputs override earlier ones, the same way a user holiday.dat
+ * overrides the system file.
+ */
+
+#include <stdio.h>
+#include "lunar-holiday-private.h"
+
+int main (int argc, char **argv)
+{
+	LunarHolidayDb *db;
+	GError *error = NULL;
+	int i;
+
+	if (argc < 3)
+	{
+		fprintf(stderr, "Usage: %s INPUT... OUTPUT\n", argv[0]);
+		return 1;
+	}
+
+	db = _lunar_holiday_db_new();
+	for (i = 1; i < argc - 1; i++)
+	{
+		if (!_lunar_holiday_db_load_file(db, argv[i], &error))
+			goto fail;
+	}
+	if (!_lunar_holiday_db_write(db, argv[argc - 1], &error))
+		goto fail;
+
+	_lunar_holiday_db_free(db);
+	return 0;
+
+fail:
+	fprintf(stderr, "%s: %s\n", argv[0], error->message);
+	g_error_free(error);
+	_lunar_holiday_db_free(db);
+	return 1;
+}
+
+/*
+vi:ts=4:wrap:ai:
+*/
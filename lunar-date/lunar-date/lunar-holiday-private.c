@@ -0,0 +1,1146 @@
+/* vi: set sw=4 ts=4: */
+/*
+ * lunar-holiday-private.c: This file is part of liblunar
+ *
+ * Copyright (C) 2009-2011 yetist <yetist@gmail.com>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * */
+
+#include <string.h>
+#include "lunar-holiday-private.h"
+#include <gio/gio.h>
+#include <glib/gi18n-lib.h>
+
+LunarHolidayDb* _lunar_holiday_db_new (void)
+{
+	LunarHolidayDb *db;
+
+	db = g_new0(LunarHolidayDb, 1);
+	db->strings = g_ptr_array_new_with_free_func((GDestroyNotify) g_ref_string_release);
+	db->blobs = g_ptr_array_new_with_free_func((GDestroyNotify) g_bytes_unref);
+	db->names = g_ptr_array_new();
+	db->rules = g_array_new(FALSE, FALSE, sizeof(LunarHolidayRule));
+	db->workdays = g_hash_table_new_full(NULL, NULL, NULL, g_free);
+	g_mutex_init(&db->year_lock);
+	g_ptr_array_add(db->names, NULL);	/* id 0: no holiday */
+	g_ptr_array_add(db->names, "");		/* LUNAR_HOLIDAY_DB_REMOVED */
+	return db;
+}
+
+void _lunar_holiday_db_free (LunarHolidayDb *db)
+{
+	gint i;
+
+	if (db == NULL)
+		return;
+	g_ptr_array_free(db->strings, TRUE);
+	g_ptr_array_free(db->names, TRUE);
+	g_ptr_array_free(db->blobs, TRUE);
+	if (db->index != NULL)
+		g_hash_table_destroy(db->index);
+	if (db->rule_years != NULL)
+	{
+		for (i = 0; i < LUNAR_HOLIDAY_YEARS; i++)
+			if (db->rule_years[i] != NULL)
+				g_array_unref(db->rule_years[i]);
+		g_free(db->rule_years);
+	}
+	g_array_free(db->rules, TRUE);
+	for (i = 0; i < LUNAR_HOLIDAY_YEARS; i++)
+		g_free(db->years[i]);
+	g_mutex_clear(&db->year_lock);
+	g_hash_table_destroy(db->workdays);
+	g_free(db);
+}
+
+static gboolean _lunar_holiday_db_valid (gint kind, gint month, gint a, gint b)
+{
+	if (kind == LUNAR_HOLIDAY_DB_TERM_DAYS)
+		return month == 0 && a >= 0 && a < 24;
+	if (month < 1 || month > 12)
+		return FALSE;
+
+	switch (kind)
+	{
+		case LUNAR_HOLIDAY_DB_SOLAR:
+			return a >= 1 && a <= 31;
+		case LUNAR_HOLIDAY_DB_LUNAR:
+			return a >= 1 && a <= 30;
+		case LUNAR_HOLIDAY_DB_WEEK:
+			return a >= 1 && a <= 5 && b >= 0 && b <= 6;
+		case LUNAR_HOLIDAY_DB_LUNAR_LAST:
+			return a >= 1 && a <= 30 && b == 0;
+		case LUNAR_HOLIDAY_DB_WEEK_LAST:
+			return a >= 0 && a <= 6 && b == 0;
+		case LUNAR_HOLIDAY_DB_DATE:
+			return g_date_valid_dmy(a, month, LUNAR_HOLIDAY_YEAR0 + b);
+	}
+	return FALSE;
+}
+
+/* Returns the slot of @kind, or NULL if the numbers are out of range. */
+static guint16* _lunar_holiday_db_slot (LunarHolidayDb *db, gint kind, gint month, gint a, gint b)
+{
+	LunarHolidayRule rule;
+	guint i;
+
+	if (!_lunar_holiday_db_valid(kind, month, a, b))
+		return NULL;
+
+	switch (kind)
+	{
+		case LUNAR_HOLIDAY_DB_SOLAR:
+			return &db->solar[month][a];
+		case LUNAR_HOLIDAY_DB_LUNAR:
+			return &db->lunar[month][a];
+		case LUNAR_HOLIDAY_DB_WEEK:
+			return &db->week[month][a][b];
+	}
+
+	rule.id = LUNAR_HOLIDAY_ID(kind, month, a, b);
+	for (i = 0; i < db->rules->len; i++)
+		if (g_array_index(db->rules, LunarHolidayRule, i).id == rule.id)
+			return &g_array_index(db->rules, LunarHolidayRule, i).name;
+	rule.name = 0;
+	g_array_append_val(db->rules, rule);
+	return &g_array_index(db->rules, LunarHolidayRule, i).name;
+}
+
+static void _set_too_many_names (GError **error)
+{
+	g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+			_("Too many holidays, at most %u names are supported."), G_MAXUINT16 - 1);
+}
+
+/* @name must stay valid as long as @db, an empty name removes the holiday.
+ * Fails if the 16 bit slots cannot address another name. */
+static gboolean _lunar_holiday_db_set (LunarHolidayDb *db, guint16 *slot, const gchar *name, GError **error)
+{
+	if (name[0] == '\0')
+	{
+		*slot = LUNAR_HOLIDAY_DB_REMOVED;
+		return TRUE;
+	}
+	if (db->names->len > G_MAXUINT16)
+	{
+		_set_too_many_names(error);
+		return FALSE;
+	}
+	g_ptr_array_add(db->names, (gpointer) name);
+	*slot = db->names->len - 1;
+	return TRUE;
+}
+
+static void _lunar_holiday_db_index_slot (LunarHolidayDb *db, guint16 slot, guint32 id)
+{
+	const gchar *name = _lunar_holiday_db_name(db, slot);
+
+	if (name != NULL && g_hash_table_lookup(db->index, name) == NULL)
+		g_hash_table_insert(db->index, (gpointer) name, GUINT_TO_POINTER(id));
+}
+
+/* Builds the name index, a name used more than once maps to the first of
+ * its slots, lunar before solar before week before the rules. */
+static void _lunar_holiday_db_index (LunarHolidayDb *db)
+{
+	LunarHolidayRule *rule;
+	gint month, a, b;
+	guint i;
+
+	db->index = g_hash_table_new(g_str_hash, g_str_equal);
+	for (month = 1; month <= 12; month++)
+		for (a = 1; a <= 30; a++)
+			_lunar_holiday_db_index_slot(db, db->lunar[month][a],
+					LUNAR_HOLIDAY_ID(LUNAR_HOLIDAY_DB_LUNAR, month, a, 0));
+	for (month = 1; month <= 12; month++)
+		for (a = 1; a <= 31; a++)
+			_lunar_holiday_db_index_slot(db, db->solar[month][a],
+					LUNAR_HOLIDAY_ID(LUNAR_HOLIDAY_DB_SOLAR, month, a, 0));
+	for (month = 1; month <= 12; month++)
+		for (a = 1; a <= 5; a++)
+			for (b = 0; b <= 6; b++)
+				_lunar_holiday_db_index_slot(db, db->week[month][a][b],
+						LUNAR_HOLIDAY_ID(LUNAR_HOLIDAY_DB_WEEK, month, a, b));
+	for (i = 0; i < db->rules->len; i++)
+	{
+		rule = &g_array_index(db->rules, LunarHolidayRule, i);
+		_lunar_holiday_db_index_slot(db, rule->name, rule->id);
+	}
+	if (db->rules->len > 0)
+		db->rule_years = g_new0(GArray*, LUNAR_HOLIDAY_YEARS);
+}
+
+/* Parses "MMDD" (or "MMnw" for [WEEK]) into its numbers, FALSE if malformed. */
+static gboolean _parse_key (const gchar *key, gint *month, gint *a, gint *b, gboolean week)
+{
+	gint i;
+
+	for (i = 0; i < 4; i++)
+		if (!g_ascii_isdigit(key[i]))
+			return FALSE;
+	if (key[4] != '\0')
+		return FALSE;
+
+	*month = (key[0] - '0') * 10 + (key[1] - '0');
+	if (week)
+	{
+		*a = key[2] - '0';
+		*b = key[3] - '0';
+	}
+	else
+		*a = (key[2] - '0') * 10 + (key[3] - '0');
+	return *month >= 1 && *month <= 12;
+}
+
+static gboolean _parse_number (const gchar **p, gint digits, gint *n)
+{
+	for (*n = 0; digits > 0; digits--, (*p)++)
+	{
+		if (!g_ascii_isdigit(**p))
+			return FALSE;
+		*n = *n * 10 + (**p - '0');
+	}
+	return TRUE;
+}
+
+/* Parses a [RULE] key, see LunarHolidayDb, FALSE if malformed. */
+static gboolean _parse_rule (const gchar *key, gint *kind, gint *month, gint *a, gint *b)
+{
+	const gchar *p = key + 1;
+	gint sign, year;
+
+	*b = 0;
+	switch (key[0])
+	{
+		case 'L':
+		case 'W':
+			*kind = key[0] == 'L' ? LUNAR_HOLIDAY_DB_LUNAR_LAST : LUNAR_HOLIDAY_DB_WEEK_LAST;
+			if (!_parse_number(&p, 2, month) || *p++ != '-')
+				return FALSE;
+			if (!_parse_number(&p, 1, a))
+				return FALSE;
+			if (g_ascii_isdigit(*p))
+				*a = *a * 10 + (*p++ - '0');
+			break;
+		case 'T':
+			*kind = LUNAR_HOLIDAY_DB_TERM_DAYS;
+			*month = 0;
+			if (!_parse_number(&p, 2, a))
+				return FALSE;
+			if (*p != '+' && *p != '-')
+				return FALSE;
+			sign = *p++ == '-' ? -1 : 1;
+			if (!_parse_number(&p, 1, b))
+				return FALSE;
+			while (g_ascii_isdigit(*p) && *b < 1000)
+				*b = *b * 10 + (*p++ - '0');
+			if (*b > 127)
+				return FALSE;
+			*b *= sign;
+			break;
+		case 'D':
+			*kind = LUNAR_HOLIDAY_DB_DATE;
+			if (!_parse_number(&p, 4, &year) || !_parse_number(&p, 2, month) || !_parse_number(&p, 2, a))
+				return FALSE;
+			if (year < LUNAR_HOLIDAY_YEAR0 || year > LUNAR_HOLIDAY_YEAR0 + 255)
+				return FALSE;
+			*b = year - LUNAR_HOLIDAY_YEAR0;
+			break;
+		default:
+			return FALSE;
+	}
+	return *p == '\0';
+}
+
+/* @group_kind is 0 for [RULE], where each key has its own kind */
+static gboolean _load_group (LunarHolidayDb *db, GKeyFile *keyfile, const gchar *group, gint group_kind, GError **error)
+{
+	gchar **keys;
+	gint i, kind, month, a, b;
+	gboolean ret = TRUE;
+
+	keys = g_key_file_get_keys(keyfile, group, NULL, NULL);
+	if (keys == NULL)
+		return TRUE;
+
+	kind = group_kind;
+	for (i = 0; ret && keys[i] != NULL; i++)
+	{
+		gchar *value;
+		guint16 *slot;
+
+		b = 0;
+		if (group_kind == 0)
+		{
+			if (!_parse_rule(keys[i], &kind, &month, &a, &b))
+				continue;
+		}
+		else if (!_parse_key(keys[i], &month, &a, &b, kind == LUNAR_HOLIDAY_DB_WEEK))
+			continue;
+		slot = _lunar_holiday_db_slot(db, kind, month, a, b);
+		if (slot == NULL)
+			continue;
+
+		value = g_key_file_get_value(keyfile, group, keys[i], NULL);
+		if (value != NULL)
+		{
+			/* interned, so all the databases of the process share the names */
+			gchar *name = g_ref_string_new_intern(g_strstrip(value));
+
+			g_ptr_array_add(db->strings, name);
+			ret = _lunar_holiday_db_set(db, slot, name, error);
+		}
+		g_free(value);
+	}
+	g_strfreev(keys);
+	return ret;
+}
+
+static gboolean _lunar_holiday_db_load_keyfile (LunarHolidayDb *db, const gchar *data, gsize len, GError **error)
+{
+	GKeyFile *keyfile;
+	gboolean ret;
+
+	keyfile = g_key_file_new();
+	if (!g_key_file_load_from_data(keyfile, data, len, G_KEY_FILE_NONE, error))
+	{
+		g_key_file_free(keyfile);
+		return FALSE;
+	}
+
+	ret = _load_group(db, keyfile, "SOLAR", LUNAR_HOLIDAY_DB_SOLAR, error)
+		&& _load_group(db, keyfile, "LUNAR", LUNAR_HOLIDAY_DB_LUNAR, error)
+		&& _load_group(db, keyfile, "WEEK", LUNAR_HOLIDAY_DB_WEEK, error)
+		&& _load_group(db, keyfile, "RULE", 0, error);
+	g_key_file_free(keyfile);
+	return ret;
+}
+
+#define HEADER_SIZE		16
+#define ENTRY_SIZE		8
+
+static guint32 _read_le32 (const guchar *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((guint32) p[3] << 24);
+}
+
+static void _write_le32 (GString *out, guint32 v)
+{
+	g_string_append_c(out, v & 0xff);
+	g_string_append_c(out, (v >> 8) & 0xff);
+	g_string_append_c(out, (v >> 16) & 0xff);
+	g_string_append_c(out, (v >> 24) & 0xff);
+}
+
+static gboolean _is_compiled (const gchar *data, gsize len)
+{
+	return len >= HEADER_SIZE && memcmp(data, LUNAR_HOLIDAY_DB_MAGIC, 8) == 0;
+}
+
+/*
+ * Merges a compiled file into @db.  The names are used in place, @bytes
+ * is kept alive by @db.  The whole file is validated before any slot is
+ * touched, so a corrupt layer leaves @db as it was.
+ */
+static gboolean _lunar_holiday_db_load_compiled (LunarHolidayDb *db, GBytes *bytes, GError **error)
+{
+	const guchar *data, *entry;
+	gsize len, strings;
+	guint32 version, n, i, n_names;
+
+	data = g_bytes_get_data(bytes, &len);
+	version = _read_le32(data + 8);
+	n = _read_le32(data + 12);
+	if (version < 1 || version > LUNAR_HOLIDAY_DB_VERSION)
+	{
+		g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+				_("Unsupported holiday file version %u."), version);
+		return FALSE;
+	}
+	if (n > (len - HEADER_SIZE) / ENTRY_SIZE)
+		goto corrupt;
+
+	strings = HEADER_SIZE + (gsize) n * ENTRY_SIZE;
+	if (strings < len && data[len - 1] != '\0')
+		goto corrupt;
+	n_names = 0;
+	for (i = 0, entry = data + HEADER_SIZE; i < n; i++, entry += ENTRY_SIZE)
+	{
+		guint32 name = _read_le32(entry + 4);
+
+		if (name < strings || name >= len)
+			goto corrupt;
+		if (!_lunar_holiday_db_valid(entry[0], entry[1], entry[2],
+					entry[0] == LUNAR_HOLIDAY_DB_TERM_DAYS ? (gint8) entry[3] : entry[3]))
+			goto corrupt;
+		if (data[name] != '\0')
+			n_names++;
+	}
+	if (n_names > G_MAXUINT16 + 1 - db->names->len)
+	{
+		_set_too_many_names(error);
+		return FALSE;
+	}
+
+	for (i = 0, entry = data + HEADER_SIZE; i < n; i++, entry += ENTRY_SIZE)
+	{
+		guint16 *slot = _lunar_holiday_db_slot(db, entry[0], entry[1], entry[2],
+				entry[0] == LUNAR_HOLIDAY_DB_TERM_DAYS ? (gint8) entry[3] : entry[3]);
+		_lunar_holiday_db_set(db, slot, (const gchar *) data + _read_le32(entry + 4), NULL);
+	}
+	g_ptr_array_add(db->blobs, g_bytes_ref(bytes));
+	return TRUE;
+
+corrupt:
+	g_set_error(error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+			_("Corrupt compiled holiday file."));
+	return FALSE;
+}
+
+/**
+ * _lunar_holiday_db_load_bytes:
+ *
+ * Merges a holiday file held in @bytes into @db, either the holiday.dat
+ * text format or the compiled one.  Entries of the file replace the ones
+ * already in @db, so system and user files can be layered.
+ **/
+gboolean _lunar_holiday_db_load_bytes (LunarHolidayDb *db, GBytes *bytes, GError **error)
+{
+	const gchar *data;
+	gsize len;
+
+	data = g_bytes_get_data(bytes, &len);
+	if (_is_compiled(data, len))
+		return _lunar_holiday_db_load_compiled(db, bytes, error);
+	return _lunar_holiday_db_load_keyfile(db, data, len, error);
+}
+
+/**
+ * _lunar_holiday_db_load_file:
+ *
+ * Like _lunar_holiday_db_load_bytes(), for a file.  The file is mapped,
+ * a compiled file stays mapped and is used without copying.
+ **/
+gboolean _lunar_holiday_db_load_file (LunarHolidayDb *db, const gchar *filename, GError **error)
+{
+	GMappedFile *mapped;
+	GBytes *bytes;
+	gboolean ret;
+
+	mapped = g_mapped_file_new(filename, FALSE, error);
+	if (mapped == NULL)
+		return FALSE;
+	bytes = g_mapped_file_get_bytes(mapped);
+	g_mapped_file_unref(mapped);
+
+	ret = _lunar_holiday_db_load_bytes(db, bytes, error);
+	if (!ret)
+		g_prefix_error(error, "%s: ", filename);
+	g_bytes_unref(bytes);
+	return ret;
+}
+
+/* Parses "MMDD" of @year into the day of the year, 0 being January 1. */
+static gboolean _parse_workday (const gchar **p, gint year, gint *day)
+{
+	GDate date;
+	gint month, mday;
+
+	if (!_parse_number(p, 2, &month) || !_parse_number(p, 2, &mday))
+		return FALSE;
+	if (!g_date_valid_dmy(mday, month, year))
+		return FALSE;
+	g_date_clear(&date, 1);
+	g_date_set_dmy(&date, mday, month, year);
+	*day = g_date_get_day_of_year(&date) - 1;
+	return TRUE;
+}
+
+/* Marks the days @key lists in @group as workdays, or as days off. */
+static void _load_workdays (LunarWorkdayYear *days, GKeyFile *keyfile, const gchar *group,
+		gint year, const gchar *key, gboolean work)
+{
+	gchar **list;
+	gint i, first, last;
+
+	list = g_key_file_get_string_list(keyfile, group, key, NULL, NULL);
+	if (list == NULL)
+		return;
+
+	for (i = 0; list[i] != NULL; i++)
+	{
+		const gchar *p = g_strstrip(list[i]);
+
+		if (!_parse_workday(&p, year, &first))
+			continue;
+		last = first;
+		if (*p == '-')
+		{
+			p++;
+			if (!_parse_workday(&p, year, &last))
+				continue;
+		}
+		if (*p != '\0')
+			continue;
+		for (; first <= last; first++)
+		{
+			if (work)
+				days->days[first / 64] |= G_GUINT64_CONSTANT(1) << (first % 64);
+			else
+				days->days[first / 64] &= ~(G_GUINT64_CONSTANT(1) << (first % 64));
+		}
+	}
+	g_strfreev(list);
+}
+
+/**
+ * _lunar_workday_weekdays:
+ * @days: LUNAR_WORKDAY_WORDS words to fill.
+ *
+ * Sets @days to the days from Monday to Friday of @year.
+ **/
+void _lunar_workday_weekdays (gint year, guint64 *days)
+{
+	/* the weekdays of a year starting on Monday, Tuesday... */
+	static guint64 weekdays[7][LUNAR_WORKDAY_WORDS];
+	static gsize weekdays_init = 0;
+	GDate date;
+	gint first, n, i;
+
+	if (g_once_init_enter(&weekdays_init))
+	{
+		for (first = 0; first < 7; first++)
+			for (i = 0; i < LUNAR_WORKDAY_WORDS * 64; i++)
+				if ((first + i) % 7 < 5)
+					weekdays[first][i / 64] |= G_GUINT64_CONSTANT(1) << (i % 64);
+		g_once_init_leave(&weekdays_init, 1);
+	}
+
+	g_date_clear(&date, 1);
+	g_date_set_dmy(&date, 1, G_DATE_JANUARY, year);
+	first = g_date_get_weekday(&date) - G_DATE_MONDAY;
+	n = g_date_is_leap_year(year) ? 366 : 365;
+	for (i = 0; i < LUNAR_WORKDAY_WORDS; i++)
+		days[i] = i < n / 64 ? weekdays[first][i] : 0;
+	days[n / 64] = weekdays[first][n / 64] & ((G_GUINT64_CONSTANT(1) << (n % 64)) - 1);
+}
+
+/**
+ * _lunar_holiday_db_load_workdays:
+ *
+ * Merges a workday file held in @bytes into @db, see LunarWorkdayYear.
+ * The days the file lists replace their state in @db.
+ **/
+gboolean _lunar_holiday_db_load_workdays (LunarHolidayDb *db, GBytes *bytes, GError **error)
+{
+	GKeyFile *keyfile;
+	const gchar *data;
+	gchar **groups;
+	gsize len;
+	gint i;
+
+	data = g_bytes_get_data(bytes, &len);
+	keyfile = g_key_file_new();
+	if (!g_key_file_load_from_data(keyfile, data, len, G_KEY_FILE_NONE, error))
+	{
+		g_key_file_free(keyfile);
+		return FALSE;
+	}
+
+	groups = g_key_file_get_groups(keyfile, NULL);
+	for (i = 0; groups[i] != NULL; i++)
+	{
+		LunarWorkdayYear *days;
+		const gchar *p = groups[i];
+		gint year;
+
+		if (!_parse_number(&p, 4, &year) || *p != '\0' || year < 1)
+			continue;
+		days = g_hash_table_lookup(db->workdays, GINT_TO_POINTER(year));
+		if (days == NULL)
+		{
+			days = g_new(LunarWorkdayYear, 1);
+			_lunar_workday_weekdays(year, days->days);
+			g_hash_table_insert(db->workdays, GINT_TO_POINTER(year), days);
+		}
+		_load_workdays(days, keyfile, groups[i], year, "OFF", FALSE);
+		_load_workdays(days, keyfile, groups[i], year, "WORK", TRUE);
+	}
+	g_strfreev(groups);
+	g_key_file_free(keyfile);
+	return TRUE;
+}
+
+static void _write_entry (GString *entries, GString *strings, GHashTable *offsets,
+		gint kind, gint month, gint a, gint b, const gchar *name)
+{
+	gpointer offset;
+
+	if (name == NULL)
+		name = "";
+	if (!g_hash_table_lookup_extended(offsets, name, NULL, &offset))
+	{
+		offset = GSIZE_TO_POINTER(strings->len);
+		g_hash_table_insert(offsets, (gpointer) name, offset);
+		g_string_append_len(strings, name, strlen(name) + 1);
+	}
+	g_string_append_c(entries, kind);
+	g_string_append_c(entries, month);
+	g_string_append_c(entries, a);
+	g_string_append_c(entries, b);
+	/* relative to the string table for now, see _lunar_holiday_db_write() */
+	_write_le32(entries, GPOINTER_TO_SIZE(offset));
+}
+
+/**
+ * _lunar_holiday_db_write:
+ *
+ * Saves @db in the compiled format.
+ **/
+gboolean _lunar_holiday_db_write (LunarHolidayDb *db, const gchar *filename, GError **error)
+{
+	GString *entries, *strings, *out;
+	GHashTable *offsets;
+	LunarHolidayRule *rule;
+	gint m, a, b;
+	gsize i, base;
+	gboolean ret;
+
+	entries = g_string_new(NULL);
+	strings = g_string_new(NULL);
+	offsets = g_hash_table_new(g_str_hash, g_str_equal);
+
+	for (m = 1; m <= 12; m++)
+	{
+		for (a = 1; a <= 31; a++)
+			if (db->solar[m][a])
+				_write_entry(entries, strings, offsets, LUNAR_HOLIDAY_DB_SOLAR, m, a, 0, _lunar_holiday_db_solar(db, m, a));
+		for (a = 1; a <= 30; a++)
+			if (db->lunar[m][a])
+				_write_entry(entries, strings, offsets, LUNAR_HOLIDAY_DB_LUNAR, m, a, 0, _lunar_holiday_db_lunar(db, m, a));
+		for (a = 1; a <= 5; a++)
+			for (b = 0; b <= 6; b++)
+				if (db->week[m][a][b])
+					_write_entry(entries, strings, offsets, LUNAR_HOLIDAY_DB_WEEK, m, a, b, _lunar_holiday_db_week(db, m, a, b));
+	}
+	for (i = 0; i < db->rules->len; i++)
+	{
+		rule = &g_array_index(db->rules, LunarHolidayRule, i);
+		if (rule->name)
+			_write_entry(entries, strings, offsets, LUNAR_HOLIDAY_ID_KIND(rule->id), LUNAR_HOLIDAY_ID_MONTH(rule->id),
+					LUNAR_HOLIDAY_ID_A(rule->id), LUNAR_HOLIDAY_ID_B(rule->id), _lunar_holiday_db_name(db, rule->name));
+	}
+
+	out = g_string_new(LUNAR_HOLIDAY_DB_MAGIC);
+	_write_le32(out, LUNAR_HOLIDAY_DB_VERSION);
+	_write_le32(out, entries->len / ENTRY_SIZE);
+	base = HEADER_SIZE + entries->len;
+	for (i = 0; i < entries->len; i += ENTRY_SIZE)
+	{
+		g_string_append_len(out, entries->str + i, 4);
+		_write_le32(out, base + _read_le32((const guchar *) entries->str + i + 4));
+	}
+	g_string_append_len(out, strings->str, strings->len);
+
+	ret = g_file_set_contents(filename, out->str, out->len, error);
+
+	g_hash_table_destroy(offsets);
+	g_string_free(entries, TRUE);
+	g_string_free(strings, TRUE);
+	g_string_free(out, TRUE);
+	return ret;
+}
+
+/*
+ * The holiday sets of the process: the defaults of a locale, embedded in
+ * the library, with the user's files layered on top.  A set is loaded
+ * once and shared by every LunarDate of that locale, and reloaded when
+ * one of the files changes.
+ *
+ * Readers never lock or wait: they count themselves in the reader
+ * counter of the current epoch, then load the published snapshot.  The
+ * watch thread builds a new snapshot, publishes it, then flips the epoch
+ * twice, each time after the counter of the previous epoch has drained.
+ * Whoever could still see the old snapshot is counted in one of the
+ * two, so it can be freed afterwards.  The watch thread polls the
+ * counters from a short timeout rather than waiting, so the other sets
+ * keep being served meanwhile.
+ *
+ * Compiled files stay mapped, they must be replaced by a rename (as
+ * lunar-holiday-compile does) rather than rewritten in place.
+ */
+struct _LunarHolidaySet
+{
+	gchar			 *key;			/* the resource and the files, joined */
+	gchar			 *resource;		/* the defaults built in the library */
+	gchar			**files;		/* the user's overrides */
+	gchar			 *workday_resource;
+	gchar			**workday_files;
+	gint			  ref_count;	/* under the registry lock */
+	GOnce			  load_once;
+	LunarHolidayDb	 *current;
+	gint			  readers[2];
+	gint			  epoch;
+	LunarHolidayDb	 *retired;		/* watch thread only, freed by retiring */
+	gint			  retired_epoch;
+	GSource			 *retiring;
+	GPtrArray		 *monitors;
+	gboolean		  watched;
+	GSource			 *pending;		/* watch thread only */
+	GSource			 *linger;		/* under the registry lock */
+};
+
+/* sets no longer used are kept this long, in case a new date comes */
+#define HOLIDAY_SET_LINGER	30
+
+G_LOCK_DEFINE_STATIC (holiday_registry);
+static GHashTable	*holiday_sets = NULL;		/* files -> set */
+static GHashTable	*holiday_locales = NULL;	/* interned language -> set */
+static GMainContext *holiday_context = NULL;
+static GMutex		 holiday_watch_mutex;
+static GCond		 holiday_watch_cond;
+static guint		 holiday_serial = 0;
+
+/* sets the static entry points keep for good, one per language */
+typedef struct _LunarHolidayPin LunarHolidayPin;
+
+struct _LunarHolidayPin
+{
+	LunarHolidayPin *next;
+	const gchar		*locale;
+	LunarHolidaySet *set;
+};
+
+static LunarHolidayPin *holiday_pins = NULL;
+
+/* Returns the embedded @prefix file of the current locale, NULL if there is none. */
+static gchar* _lunar_holidays_find_resource (const gchar *prefix, const gchar *suffix)
+{
+	const gchar* const * langs =  g_get_language_names();
+	gchar *path;
+	guint i;
+
+	for (i = 0; langs[i] && langs[i][0] != '\0'; i++)
+	{
+		if (!g_str_has_prefix(langs[i], "zh_") || strlen(langs[i]) < 5)
+			continue;
+		path = g_strdup_printf("%s%.5s%s", prefix, langs[i], suffix);
+		if (g_resources_get_info(path, G_RESOURCE_LOOKUP_FLAGS_NONE, NULL, NULL, NULL))
+			return path;
+		g_free(path);
+	}
+	return NULL;
+}
+
+/* Loads the workday layers into @db, FALSE if one of them is broken. */
+static gboolean _lunar_holiday_set_load_workdays (LunarHolidaySet *set, LunarHolidayDb *db)
+{
+	GError *error = NULL;
+	GBytes *bytes;
+	gchar *data;
+	gsize len;
+	gint i;
+
+	if (set->workday_resource != NULL)
+	{
+		bytes = g_resources_lookup_data(set->workday_resource, G_RESOURCE_LOOKUP_FLAGS_NONE, NULL);
+		_lunar_holiday_db_load_workdays(db, bytes, NULL);
+		g_bytes_unref(bytes);
+	}
+	for (i = 0; set->workday_files[i] != NULL; i++)
+	{
+		if (!g_file_test(set->workday_files[i], G_FILE_TEST_EXISTS |G_FILE_TEST_IS_REGULAR))
+			continue;
+		if (g_file_get_contents(set->workday_files[i], &data, &len, &error))
+		{
+			bytes = g_bytes_new_take(data, len);
+			if (!_lunar_holiday_db_load_workdays(db, bytes, &error))
+				g_prefix_error(&error, "%s: ", set->workday_files[i]);
+			g_bytes_unref(bytes);
+		}
+		if (error != NULL)
+		{
+			g_critical("Format error \"%s\" !!!\n", error->message);
+			g_error_free(error);
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/* Loads all the layers, NULL if one of them is broken. */
+static LunarHolidayDb* _lunar_holiday_set_load (LunarHolidaySet *set)
+{
+	LunarHolidayDb *db;
+	GError *error = NULL;
+	gint i;
+
+	db = _lunar_holiday_db_new();
+	if (set->resource != NULL)
+	{
+		/* in the library's read-only data, used without copying */
+		GBytes *bytes = g_resources_lookup_data(set->resource, G_RESOURCE_LOOKUP_FLAGS_NONE, NULL);
+
+		_lunar_holiday_db_load_bytes(db, bytes, NULL);
+		g_bytes_unref(bytes);
+	}
+	for (i = 0; set->files[i] != NULL; i++)
+	{
+		if (!g_file_test(set->files[i], G_FILE_TEST_EXISTS |G_FILE_TEST_IS_REGULAR))
+			continue;
+		if (!_lunar_holiday_db_load_file(db, set->files[i], &error))
+		{
+			g_critical("Format error \"%s\" !!!\n", error->message);
+			g_error_free(error);
+			_lunar_holiday_db_free(db);
+			return NULL;
+		}
+	}
+	if (!_lunar_holiday_set_load_workdays(set, db))
+	{
+		_lunar_holiday_db_free(db);
+		return NULL;
+	}
+	_lunar_holiday_db_index(db);
+	return db;
+}
+
+/* Polled in the watch thread until nobody can see the retired snapshot. */
+static gboolean _lunar_holiday_set_retire (gpointer data)
+{
+	LunarHolidaySet *set = data;
+	gint epoch;
+
+	epoch = g_atomic_int_get(&set->epoch);
+	if (g_atomic_int_get(&set->readers[(epoch - 1) & 1]) != 0)
+		return TRUE;
+	if (epoch == set->retired_epoch + 1)
+	{
+		g_atomic_int_set(&set->epoch, epoch + 1);
+		return TRUE;
+	}
+
+	_lunar_holiday_db_free(set->retired);
+	set->retired = NULL;
+	set->retiring = NULL;
+	return FALSE;
+}
+
+static gboolean _lunar_holiday_set_reload (gpointer data)
+{
+	LunarHolidaySet *set = data;
+	LunarHolidayDb *db, *old;
+
+	/* one snapshot retires at a time, come back later */
+	if (set->retiring != NULL)
+		return TRUE;
+
+	set->pending = NULL;
+	db = _lunar_holiday_set_load(set);
+	if (db == NULL)
+		return FALSE;		/* keep the last good snapshot */
+
+	/* the first load may publish concurrently, see _lunar_holiday_set_do_load() */
+	do
+		old = g_atomic_pointer_get(&set->current);
+	while (!g_atomic_pointer_compare_and_exchange(&set->current, old, db));
+	g_atomic_int_inc(&holiday_serial);
+	if (old == NULL)
+		return FALSE;
+
+	set->retired = old;
+	set->retired_epoch = g_atomic_int_get(&set->epoch);
+	g_atomic_int_set(&set->epoch, set->retired_epoch + 1);
+	set->retiring = g_timeout_source_new(1);
+	g_source_set_callback(set->retiring, _lunar_holiday_set_retire, set, NULL);
+	g_source_attach(set->retiring, holiday_context);
+	g_source_unref(set->retiring);
+	return FALSE;
+}
+
+static void _lunar_holiday_set_changed (GFileMonitor *monitor, GFile *file, GFile *other,
+		GFileMonitorEvent event, gpointer data)
+{
+	LunarHolidaySet *set = data;
+
+	if (event == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED || set->pending != NULL)
+		return;
+
+	/* editors write in several steps, wait for the last one */
+	set->pending = g_timeout_source_new(200);
+	g_source_set_callback(set->pending, _lunar_holiday_set_reload, set, NULL);
+	g_source_attach(set->pending, holiday_context);
+	g_source_unref(set->pending);
+}
+
+static void _lunar_holiday_set_monitor (LunarHolidaySet *set, gchar **files)
+{
+	gint i;
+
+	for (i = 0; files[i] != NULL; i++)
+	{
+		GFile *file = g_file_new_for_path(files[i]);
+		GFileMonitor *monitor = g_file_monitor_file(file, G_FILE_MONITOR_NONE, NULL, NULL);
+
+		if (monitor != NULL)
+		{
+			g_signal_connect(monitor, "changed", G_CALLBACK(_lunar_holiday_set_changed), set);
+			g_ptr_array_add(set->monitors, monitor);
+		}
+		g_object_unref(file);
+	}
+}
+
+/* Runs in the watch thread, monitors deliver to the context they are made in. */
+static gboolean _lunar_holiday_set_watch (gpointer data)
+{
+	LunarHolidaySet *set = data;
+
+	_lunar_holiday_set_monitor(set, set->files);
+	_lunar_holiday_set_monitor(set, set->workday_files);
+
+	g_mutex_lock(&holiday_watch_mutex);
+	set->watched = TRUE;
+	g_cond_broadcast(&holiday_watch_cond);
+	g_mutex_unlock(&holiday_watch_mutex);
+	return FALSE;
+}
+
+static gpointer _lunar_holiday_set_do_load (gpointer data)
+{
+	LunarHolidaySet *set = data;
+	LunarHolidayDb *db;
+
+	/* watch before loading, so that no change is missed */
+	g_main_context_invoke(holiday_context, _lunar_holiday_set_watch, set);
+	g_mutex_lock(&holiday_watch_mutex);
+	while (!set->watched)
+		g_cond_wait(&holiday_watch_cond, &holiday_watch_mutex);
+	g_mutex_unlock(&holiday_watch_mutex);
+
+	db = _lunar_holiday_set_load(set);
+	if (db == NULL)
+	{
+		db = _lunar_holiday_db_new();
+		_lunar_holiday_db_index(db);
+	}
+	/* a change seen meanwhile has published a newer snapshot, keep it */
+	if (!g_atomic_pointer_compare_and_exchange(&set->current, NULL, db))
+		_lunar_holiday_db_free(db);
+	return NULL;
+}
+
+static gboolean _lunar_holiday_set_is (gpointer key, gpointer value, gpointer set)
+{
+	return value == set;
+}
+
+/* Called in the watch thread, where the monitors deliver their signals. */
+static gboolean _lunar_holiday_set_free (gpointer data)
+{
+	LunarHolidaySet *set = data;
+
+	G_LOCK (holiday_registry);
+	/* used again, or unused again later with a new timeout */
+	if (set->linger != g_main_current_source())
+	{
+		G_UNLOCK (holiday_registry);
+		return FALSE;
+	}
+	g_source_unref(set->linger);
+	g_hash_table_remove(holiday_sets, set->key);
+	g_hash_table_foreach_remove(holiday_locales, _lunar_holiday_set_is, set);
+	G_UNLOCK (holiday_registry);
+
+	if (set->pending != NULL)
+		g_source_destroy(set->pending);
+	if (set->retiring != NULL)
+		g_source_destroy(set->retiring);
+	_lunar_holiday_db_free(set->retired);
+	g_ptr_array_foreach(set->monitors, (GFunc) g_file_monitor_cancel, NULL);
+	g_ptr_array_free(set->monitors, TRUE);
+	_lunar_holiday_db_free(set->current);
+	g_strfreev(set->files);
+	g_free(set->resource);
+	g_strfreev(set->workday_files);
+	g_free(set->workday_resource);
+	g_free(set->key);
+	g_free(set);
+	return FALSE;
+}
+
+static gpointer _lunar_holidays_watch (gpointer data)
+{
+	g_main_context_push_thread_default(holiday_context);
+	g_main_loop_run(g_main_loop_new(holiday_context, FALSE));
+	return NULL;
+}
+
+/* Must be called with the registry lock held. */
+static LunarHolidaySet* _lunar_holiday_set_lookup (void)
+{
+	LunarHolidaySet *set;
+	gchar *resource, *workday_resource, *user_file, *workday_file, *key;
+
+	/* the defaults of the locale, the user files override their entries */
+	resource = _lunar_holidays_find_resource(LUNAR_HOLIDAY_RESOURCE "holiday.", ".bin");
+	workday_resource = _lunar_holidays_find_resource(LUNAR_HOLIDAY_RESOURCE "workday.", "");
+	user_file = g_build_filename(g_get_user_config_dir(), "liblunar", "holiday.dat", NULL);
+	workday_file = g_build_filename(g_get_user_config_dir(), "liblunar", "workday.dat", NULL);
+	key = g_strconcat(resource ? resource : "", "\n", workday_resource ? workday_resource : "",
+			"\n", user_file, "\n", workday_file, NULL);
+
+	set = g_hash_table_lookup(holiday_sets, key);
+	if (set != NULL)
+	{
+		g_free(key);
+		g_free(resource);
+		g_free(workday_resource);
+		g_free(user_file);
+		g_free(workday_file);
+		return set;
+	}
+
+	set = g_new0(LunarHolidaySet, 1);
+	set->key = key;
+	set->resource = resource;
+	set->files = g_new0(gchar *, 2);
+	set->files[0] = user_file;
+	set->workday_resource = workday_resource;
+	set->workday_files = g_new0(gchar *, 2);
+	set->workday_files[0] = workday_file;
+	set->monitors = g_ptr_array_new_with_free_func(g_object_unref);
+	g_hash_table_insert(holiday_sets, set->key, set);
+	return set;
+}
+
+/**
+ * _lunar_holiday_set_get:
+ *
+ * Returns a reference to the holidays of the current locale, shared by
+ * the whole process.  Nothing is loaded until the first
+ * _lunar_holiday_set_acquire().
+ **/
+LunarHolidaySet* _lunar_holiday_set_get (void)
+{
+	LunarHolidaySet *set;
+	const gchar *locale;
+
+	locale = g_intern_string(g_get_language_names()[0]);
+
+	G_LOCK (holiday_registry);
+	if (holiday_sets == NULL)
+	{
+		holiday_sets = g_hash_table_new(g_str_hash, g_str_equal);
+		holiday_locales = g_hash_table_new(NULL, NULL);
+		/* the changes are dispatched, and the reloads done, in this thread */
+		holiday_context = g_main_context_new();
+		g_thread_unref(g_thread_new("lunar-holidays", _lunar_holidays_watch, NULL));
+	}
+
+	set = g_hash_table_lookup(holiday_locales, locale);
+	if (set == NULL)
+	{
+		set = _lunar_holiday_set_lookup();
+		g_hash_table_insert(holiday_locales, (gpointer) locale, set);
+	}
+	if (set->linger != NULL)
+	{
+		g_source_destroy(set->linger);
+		g_source_unref(set->linger);
+		set->linger = NULL;
+	}
+	set->ref_count++;
+	G_UNLOCK (holiday_registry);
+
+	return set;
+}
+
+void _lunar_holiday_set_unref (LunarHolidaySet *set)
+{
+	G_LOCK (holiday_registry);
+	if (--set->ref_count == 0)
+	{
+		set->linger = g_timeout_source_new_seconds(HOLIDAY_SET_LINGER);
+		g_source_set_callback(set->linger, _lunar_holiday_set_free, set, NULL);
+		g_source_attach(set->linger, holiday_context);
+	}
+	G_UNLOCK (holiday_registry);
+}
+
+/**
+ * _lunar_holiday_set_peek:
+ *
+ * Returns the holidays of the current locale, like _lunar_holiday_set_get(),
+ * but without a reference to drop: the set is kept for the life of the
+ * process.  For the functions working without a #LunarDate, so that each
+ * call neither takes the registry lock nor restarts the linger.
+ **/
+LunarHolidaySet* _lunar_holiday_set_peek (void)
+{
+	LunarHolidayPin *pin;
+	const gchar *locale;
+
+	locale = g_get_language_names()[0];
+	for (pin = g_atomic_pointer_get(&holiday_pins); pin != NULL; pin = pin->next)
+		if (strcmp(pin->locale, locale) == 0)
+			return pin->set;
+
+	/* two threads may pin the same language, the spare pin is harmless */
+	pin = g_new(LunarHolidayPin, 1);
+	pin->locale = g_intern_string(locale);
+	pin->set = _lunar_holiday_set_get();
+	do
+		pin->next = g_atomic_pointer_get(&holiday_pins);
+	while (!g_atomic_pointer_compare_and_exchange(&holiday_pins, pin->next, pin));
+	return pin->set;
+}
+
+/**
+ * _lunar_holiday_set_acquire:
+ * @ticket: return location for the value to pass to _lunar_holiday_set_release()
+ *
+ * Returns the current holidays of @set, never %NULL.  They stay valid
+ * until _lunar_holiday_set_release(), which must come soon, as a pending
+ * reload waits for it.
+ **/
+LunarHolidayDb* _lunar_holiday_set_acquire (LunarHolidaySet *set, gint *ticket)
+{
+	g_once(&set->load_once, _lunar_holiday_set_do_load, set);
+	*ticket = g_atomic_int_get(&set->epoch) & 1;
+	g_atomic_int_inc(&set->readers[*ticket]);
+	return g_atomic_pointer_get(&set->current);
+}
+
+void _lunar_holiday_set_release (LunarHolidaySet *set, gint ticket)
+{
+	g_atomic_int_dec_and_test(&set->readers[ticket]);
+}
+
+/**
+ * _lunar_holidays_serial:
+ *
+ * Returns a number changed by every reload, for caches of data derived
+ * from the holidays.
+ **/
+guint _lunar_holidays_serial (void)
+{
+	return g_atomic_int_get(&holiday_serial);
+}
+
+/*
+vi:ts=4:wrap:ai:
+*/
@@ -0,0 +1,209 @@
+/* vi: set sw=4 ts=4: */
+/*
+ * lunar-holiday-private.h: This file is part of liblunar.
+ *
+ * Copyright (C) 2009-2011 yetist <yetist@gmail.com>
+ *
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ * */
+
+#ifndef __LUNAR_HOLIDAY_PRIVATE_H__
+#define __LUNAR_HOLIDAY_PRIVATE_H__  1
+
+#if HAVE_CONFIG_H
+	#include <config.h>
+#endif
+#include <glib.h>
+#include <lunar-date/lunar-holiday.h>
+G_BEGIN_DECLS
+
+typedef struct	_LunarHolidayDb			 LunarHolidayDb;
+typedef struct	_LunarHolidaySet		 LunarHolidaySet;
+typedef struct	_LunarHolidayRule		 LunarHolidayRule;
+typedef struct	_LunarHolidayRuleDay	 LunarHolidayRuleDay;
+typedef struct	_LunarHolidayYear		 LunarHolidayYear;
+typedef struct	_LunarWorkdayYear		 LunarWorkdayYear;
+
+/* the solar years rule_years[] and years[] cover, BEGIN_YEAR and on */
+#define LUNAR_HOLIDAY_YEAR0			1900
+#define LUNAR_HOLIDAY_YEARS			151
+/* the 64-bit words of a year of days, see LunarWorkdayYear */
+#define LUNAR_WORKDAY_WORDS			6
+
+/*
+ * The holiday file parsed into direct-index tables.
+ *
+ * Every table slot holds a holiday id, 0 meaning no holiday and 1 one
+ * removed by an override layer.  The id indexes names[], so a lookup is
+ * two array loads and never copies.  index maps each name back to the
+ * public id of its slot, see LUNAR_HOLIDAY_ID().
+ *   solar[month][day]		  [SOLAR] MMDD
+ *   lunar[month][day]		  [LUNAR] MMDD
+ *   week[month][nth][weekday]  [WEEK]  MMnw, n: 1-5, w: 0 (Sunday) - 6
+ *
+ * The [RULE] holidays do not map to one slot, rules[] lists them and
+ * rule_years[] caches their days in each solar year, computed on first
+ * use, see _lunar_holiday_db_rule_days().
+ *   Lmm-n		  the nth last day of lunar month mm
+ *   Wmm-w		  the last weekday w of month mm
+ *   Tnn+d, Tnn-d  d days after or before solar term nn, 0 is Xiaohan
+ *   Dyyyymmdd	  the day, in that year only
+ *
+ * years[] keeps the holidays of each day of the years in use, built on
+ * first use and kept until @db is freed, see _lunar_holiday_db_year().
+ * year_lock only serializes the building, readers load the pointer.
+ *
+ * workdays maps the solar years of the workday files to their
+ * LunarWorkdayYear, the other years work from Monday to Friday.
+ */
+struct _LunarHolidayDb
+{
+	GPtrArray	 *strings;
+	GPtrArray	 *blobs;
+	GPtrArray	 *names;
+	GHashTable	 *index;
+	guint16		  solar[13][32];
+	guint16		  lunar[13][31];
+	guint16		  week[13][6][7];
+	GArray		 *rules;
+	GArray		**rule_years;
+	GMutex		  year_lock;
+	LunarHolidayYear *years[LUNAR_HOLIDAY_YEARS];
+	GHashTable	 *workdays;
+};
+
+struct _LunarHolidayRule
+{
+	guint32		  id;
+	guint16		  name;
+};
+
+struct _LunarHolidayRuleDay
+{
+	guint32		  julian;
+	guint32		  id;
+	const gchar	 *name;
+};
+
+/*
+ * The holidays of a solar year: those of day d, counted from January 1,
+ * are entries[offsets[d]] .. entries[offsets[d + 1] - 1].
+ */
+struct _LunarHolidayYear
+{
+	gint		  year;
+	guint32		  julian;
+	guint16		  offsets[367];
+	const LunarHoliday *entries[];
+};
+
+/*
+ * The workdays of a solar year, bit d % 64 of days[d / 64] is day d,
+ * counted from January 1.  The bits past the end of the year are 0.
+ */
+struct _LunarWorkdayYear
+{
+	guint64		  days[LUNAR_WORKDAY_WORDS];
+};
+
+/*
+ * Workday file, a key file with a group for each solar year:
+ *
+ *	 [2024]
+ *	 OFF=0101;0210-0217		the days off, MMDD or a range MMDD-MMDD
+ *	 WORK=0204;0218			the weekend days worked
+ *
+ * The days a file does not list keep their state from the lower layers,
+ * Monday to Friday being the workdays at the bottom.
+ */
+/*
+ * Compiled holiday file, all integers little endian:
+ *
+ *	 header  "LUNARHOL", guint32 version, guint32 n_entries
+ *	 entries n_entries * { guint8 kind, month, a, b; guint32 name }
+ *	 strings NUL-terminated UTF-8 names, entry.name is the offset from
+ *			 the start of the file
+ *
+ * kind is one of the LUNAR_HOLIDAY_DB_* values below, (a, b) is (day, 0)
+ * or (nth, weekday).  For the rules (a, b) is (n, 0) for Lmm-n, (w, 0)
+ * for Wmm-w, (nn, d as gint8) for Tnn+d with month 0, and (dd, yyyy -
+ * LUNAR_HOLIDAY_YEAR0) for Dyyyymmdd.  An empty name removes the holiday of a lower
+ * layer.  Version 1 files have no rules.
+ */
+#define LUNAR_HOLIDAY_DB_MAGIC		"LUNARHOL"
+#define LUNAR_HOLIDAY_RESOURCE		"/org/liblunar/holiday/"
+#define LUNAR_HOLIDAY_DB_VERSION	2
+
+/* the same values as LunarHolidayKind */
+enum
+{
+	LUNAR_HOLIDAY_DB_SOLAR = 1,
+	LUNAR_HOLIDAY_DB_LUNAR,
+	LUNAR_HOLIDAY_DB_WEEK,
+	LUNAR_HOLIDAY_DB_LUNAR_LAST = 5,
+	LUNAR_HOLIDAY_DB_WEEK_LAST,
+	LUNAR_HOLIDAY_DB_TERM_DAYS,
+	LUNAR_HOLIDAY_DB_DATE
+};
+
+LunarHolidayDb* _lunar_holiday_db_new (void);
+void	_lunar_holiday_db_free (LunarHolidayDb *db);
+gboolean _lunar_holiday_db_load_file (LunarHolidayDb *db, const gchar *filename, GError **error);
+gboolean _lunar_holiday_db_load_bytes (LunarHolidayDb *db, GBytes *bytes, GError **error);
+gboolean _lunar_holiday_db_write (LunarHolidayDb *db, const gchar *filename, GError **error);
+gboolean _lunar_holiday_db_load_workdays (LunarHolidayDb *db, GBytes *bytes, GError **error);
+void	_lunar_workday_weekdays (gint year, guint64 *days);
+
+LunarHolidaySet* _lunar_holiday_set_get (void);
+void	_lunar_holiday_set_unref (LunarHolidaySet *set);
+LunarHolidaySet* _lunar_holiday_set_peek (void);
+LunarHolidayDb* _lunar_holiday_set_acquire (LunarHolidaySet *set, gint *ticket);
+void	_lunar_holiday_set_release (LunarHolidaySet *set, gint ticket);
+guint	_lunar_holidays_serial (void);
+
+GArray*	_lunar_holiday_db_rule_days (LunarHolidayDb *db, gint year);
+const LunarHolidayYear* _lunar_holiday_db_year (LunarHolidayDb *db, gint year);
+extern const guint8 _lunar_holiday_kind_order[];
+
+#define LUNAR_HOLIDAY_DB_REMOVED	1
+
+/*
+ * The public holiday ids are the kind and the table slot, the same four
+ * bytes as a compiled entry.  A solar term is (LUNAR_HOLIDAY_KIND_TERM,
+ * 0, n, 0).
+ */
+#define LUNAR_HOLIDAY_ID(kind, month, a, b) \
+	((guint32) (((kind) << 24) | ((month) << 16) | (((a) & 0xff) << 8) | ((b) & 0xff)))
+#define LUNAR_HOLIDAY_ID_KIND(id)	((id) >> 24)
+#define LUNAR_HOLIDAY_ID_MONTH(id)	(((id) >> 16) & 0xff)
+#define LUNAR_HOLIDAY_ID_A(id)		(((id) >> 8) & 0xff)
+#define LUNAR_HOLIDAY_ID_B(id)		((id) & 0xff)
+
+#define _lunar_holiday_db_name(db, id) \
+	((id) > LUNAR_HOLIDAY_DB_REMOVED ? (const gchar *) g_ptr_array_index((db)->names, (id)) : NULL)
+#define _lunar_holiday_db_solar(db, month, day) \
+	_lunar_holiday_db_name((db), (db)->solar[(month)][(day)])
+#define _lunar_holiday_db_lunar(db, month, day) \
+	_lunar_holiday_db_name((db), (db)->lunar[(month)][(day)])
+#define _lunar_holiday_db_week(db, month, nth, weekday) \
+	_lunar_holiday_db_name((db), (db)->week[(month)][(nth)][(weekday)])
+
+G_END_DECLS
+
+#endif /* __LUNAR_HOLIDAY_PRIVATE_H__ */
+
+/*
+vi:ts=4:wrap:ai:
+*/
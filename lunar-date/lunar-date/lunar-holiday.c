@@ -0,0 +1,765 @@
+/* vi: set sw=4 ts=4: */
+/*
+ * lunar-holiday.c
+ *
+ * This file is part of liblunar.
+ *
+ * Copyright (C) 2007-2011 yetist <yetist@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ * */
+
+#if HAVE_CONFIG_H
+	#include <config.h>
+#endif
+#include <string.h>
+#include <lunar-date/lunar-holiday.h>
+#include "lunar-date-private.h"
+#include "lunar-holiday-private.h"
+
+/**
+ * SECTION:lunar-holiday
+ * @Short_description: Holidays and solar terms of a date range
+ * @Title: Holidays
+ *
+ * lunar_holidays_in_range() lists the holidays of many days at once, it
+ * computes the days of each holiday rule instead of converting every
+ * day of the range.  lunar_holiday_find() goes the other way, from the
+ * name of a holiday to its day in a year.
+ */
+
+G_STATIC_ASSERT((gint) LUNAR_HOLIDAY_KIND_SOLAR == LUNAR_HOLIDAY_DB_SOLAR);
+G_STATIC_ASSERT((gint) LUNAR_HOLIDAY_KIND_LUNAR == LUNAR_HOLIDAY_DB_LUNAR);
+G_STATIC_ASSERT((gint) LUNAR_HOLIDAY_KIND_WEEK == LUNAR_HOLIDAY_DB_WEEK);
+G_STATIC_ASSERT((gint) LUNAR_HOLIDAY_KIND_LUNAR_LAST == LUNAR_HOLIDAY_DB_LUNAR_LAST);
+G_STATIC_ASSERT((gint) LUNAR_HOLIDAY_KIND_WEEK_LAST == LUNAR_HOLIDAY_DB_WEEK_LAST);
+G_STATIC_ASSERT((gint) LUNAR_HOLIDAY_KIND_TERM_DAYS == LUNAR_HOLIDAY_DB_TERM_DAYS);
+G_STATIC_ASSERT((gint) LUNAR_HOLIDAY_KIND_DATE == LUNAR_HOLIDAY_DB_DATE);
+G_STATIC_ASSERT(LUNAR_HOLIDAY_YEAR0 == BEGIN_YEAR);
+G_STATIC_ASSERT(LUNAR_HOLIDAY_YEARS == NUM_OF_YEARS + 1);
+
+/*
+ * The order lunar_date_get_jieri() lists the holidays of a day in, by
+ * kind: lunar, solar, week, the days from a solar term, then the term.
+ */
+const guint8 _lunar_holiday_kind_order[] = {0, 1, 0, 2, 4, 0, 2, 3, 1};
+
+static guint32 _holiday_julian (gint year, gint month, gint day)
+{
+	GDate date;
+
+	g_date_clear(&date, 1);
+	g_date_set_dmy(&date, day, month, year);
+	return g_date_get_julian(&date);
+}
+
+/* The day of the nth weekday of a solar month, 0 if the month has none.
+ * It is in days 7(n-1)+1 .. 7n, see get_weekth_of_month(). */
+static gint _holiday_week_day (gint year, gint month, gint nth, gint weekday)
+{
+	gint day;
+
+	day = 7 * (nth - 1) + 1 + (weekday - get_day_of_week(year, month, 1) + 7) % 7;
+	return day <= g_date_get_days_in_month(month, year) ? day : 0;
+}
+
+static gint _holiday_year (guint32 julian)
+{
+	GDate date;
+
+	g_date_clear(&date, 1);
+	g_date_set_julian(&date, julian);
+	return g_date_get_year(&date);
+}
+
+static void _holiday_add (GArray *array, guint32 julian, guint32 id)
+{
+	LunarHolidayOccurrence occurrence;
+	gint year, month, day;
+	gboolean isleap;
+
+	_lunar_from_days(julian - LUNAR_DAYS_JULIAN, &year, &month, &day, &isleap);
+	occurrence.julian = julian;
+	occurrence.id = id;
+	occurrence.lunar_year = year;
+	occurrence.lunar_month = month;
+	occurrence.lunar_day = day;
+	occurrence.lunar_isleap = isleap;
+	occurrence.kind = LUNAR_HOLIDAY_ID_KIND(id);
+	g_array_append_val(array, occurrence);
+}
+
+static gint _holiday_compare (gconstpointer a, gconstpointer b)
+{
+	const LunarHolidayOccurrence *oa = a;
+	const LunarHolidayOccurrence *ob = b;
+
+	if (oa->julian != ob->julian)
+		return oa->julian < ob->julian ? -1 : 1;
+	if (oa->kind != ob->kind)
+		return _lunar_holiday_kind_order[oa->kind] - _lunar_holiday_kind_order[ob->kind];
+	return oa->id < ob->id ? -1 : oa->id > ob->id;
+}
+
+static gint _holiday_rule_day_compare (gconstpointer a, gconstpointer b)
+{
+	const LunarHolidayRuleDay *da = a;
+	const LunarHolidayRuleDay *db = b;
+
+	if (da->julian != db->julian)
+		return da->julian < db->julian ? -1 : 1;
+	return da->id < db->id ? -1 : da->id > db->id;
+}
+
+/* Adds the day @julian of a rule, if it is in the solar year. */
+static void _holiday_rule_add (GArray *days, gint year, guint32 julian, guint32 id, const gchar *name)
+{
+	LunarHolidayRuleDay day;
+
+	if (_holiday_year(julian) != year)
+		return;
+	day.julian = julian;
+	day.id = id;
+	day.name = name;
+	g_array_append_val(days, day);
+}
+
+/* The days of a rule in a solar year, see LunarHolidayDb. */
+static void _holiday_rule_eval (GArray *days, gint year, guint32 id, const gchar *name)
+{
+	guint month_days[NUM_OF_MONTHS + 1];
+	gint month, a, b, y, m, d, leap_month, i, len;
+	glong start;
+
+	month = LUNAR_HOLIDAY_ID_MONTH(id);
+	a = LUNAR_HOLIDAY_ID_A(id);
+	b = LUNAR_HOLIDAY_ID_B(id);
+	switch (LUNAR_HOLIDAY_ID_KIND(id))
+	{
+		case LUNAR_HOLIDAY_KIND_LUNAR_LAST:
+			/* the month of lunar year - 1 or of the lunar year, and its leap month */
+			for (y = MAX(year - 1, BEGIN_YEAR); y <= year && y < BEGIN_YEAR + NUM_OF_YEARS; y++)
+			{
+				leap_month = _lunar_make_month_days(y - BEGIN_YEAR, month_days);
+				for (i = 0; i < (leap_month == month ? 2 : 1); i++)
+				{
+					start = _lunar_to_days(y, month, 1, i, NULL);
+					len = month_days[month + (leap_month != 0 && (month > leap_month || i))];
+					if (a <= len)
+						_holiday_rule_add(days, year, start + len - a + LUNAR_DAYS_JULIAN, id, name);
+				}
+			}
+			break;
+		case LUNAR_HOLIDAY_KIND_WEEK_LAST:
+			len = g_date_get_days_in_month(month, year);
+			d = len - (get_day_of_week(year, month, len) - a + 7) % 7;
+			_holiday_rule_add(days, year, _holiday_julian(year, month, d), id, name);
+			break;
+		case LUNAR_HOLIDAY_KIND_TERM_DAYS:
+			/* an offset may move the day of a term into the next or last year */
+			for (i = year - 1; i <= year + 1; i++)
+			{
+				_solar_term_date(i, a, &y, &m, &d);
+				_holiday_rule_add(days, year, _holiday_julian(y, m, d) + (gint8) b, id, name);
+			}
+			break;
+		case LUNAR_HOLIDAY_KIND_DATE:
+			if (year == BEGIN_YEAR + b)
+				_holiday_rule_add(days, year, _holiday_julian(year, month, a), id, name);
+			break;
+		default:
+			break;
+	}
+}
+
+/**
+ * _lunar_holiday_db_rule_days:
+ *
+ * Returns the days of the [RULE] holidays of @db in a solar year, a
+ * #GArray of #LunarHolidayRuleDay sorted by day.  They are computed
+ * once per year and owned by @db.
+ *
+ * Return value: the days, %NULL if @db has no rules or @year is out of
+ * range.
+ **/
+GArray* _lunar_holiday_db_rule_days (LunarHolidayDb *db, gint year)
+{
+	LunarHolidayRule *rule;
+	GArray *days;
+	guint i;
+
+	if (db->rule_years == NULL || year < BEGIN_YEAR || year >= BEGIN_YEAR + LUNAR_HOLIDAY_YEARS)
+		return NULL;
+
+	days = g_atomic_pointer_get(&db->rule_years[year - BEGIN_YEAR]);
+	if (days != NULL)
+		return days;
+
+	days = g_array_new(FALSE, FALSE, sizeof(LunarHolidayRuleDay));
+	for (i = 0; i < db->rules->len; i++)
+	{
+		rule = &g_array_index(db->rules, LunarHolidayRule, i);
+		if (rule->name > LUNAR_HOLIDAY_DB_REMOVED)
+			_holiday_rule_eval(days, year, rule->id, _lunar_holiday_db_name(db, rule->name));
+	}
+	g_array_sort(days, _holiday_rule_day_compare);
+
+	/* another thread may have got there first */
+	if (!g_atomic_pointer_compare_and_exchange(&db->rule_years[year - BEGIN_YEAR], NULL, days))
+	{
+		g_array_unref(days);
+		days = g_atomic_pointer_get(&db->rule_years[year - BEGIN_YEAR]);
+	}
+	return days;
+}
+
+/* [SOLAR], [WEEK], [RULE] and the solar terms of a solar year */
+static void _holiday_solar_year (LunarHolidayDb *db, gint year,
+		guint32 first, guint32 last, GArray *array)
+{
+	gint month, day, days, nth, weekday, y, m, d, n;
+	guint32 julian, julian1;
+	GArray *rule_days;
+	guint i;
+
+	for (month = 1; month <= 12; month++)
+	{
+		days = g_date_get_days_in_month(month, year);
+		julian1 = _holiday_julian(year, month, 1);
+		if (julian1 > last || julian1 + days - 1 < first)
+			continue;
+		for (day = 1; day <= days; day++)
+		{
+			julian = julian1 + day - 1;
+			if (db->solar[month][day] > LUNAR_HOLIDAY_DB_REMOVED && julian >= first && julian <= last)
+				_holiday_add(array, julian, LUNAR_HOLIDAY_ID(LUNAR_HOLIDAY_KIND_SOLAR, month, day, 0));
+		}
+		for (nth = 1; nth <= 5; nth++)
+		{
+			for (weekday = 0; weekday < 7; weekday++)
+			{
+				if (db->week[month][nth][weekday] <= LUNAR_HOLIDAY_DB_REMOVED)
+					continue;
+				day = _holiday_week_day(year, month, nth, weekday);
+				julian = julian1 + day - 1;
+				if (day != 0 && julian >= first && julian <= last)
+					_holiday_add(array, julian, LUNAR_HOLIDAY_ID(LUNAR_HOLIDAY_KIND_WEEK, month, nth, weekday));
+			}
+		}
+	}
+
+	rule_days = _lunar_holiday_db_rule_days(db, year);
+	for (i = 0; rule_days != NULL && i < rule_days->len; i++)
+	{
+		LunarHolidayRuleDay *rule_day = &g_array_index(rule_days, LunarHolidayRuleDay, i);
+
+		if (rule_day->julian >= first && rule_day->julian <= last)
+			_holiday_add(array, rule_day->julian, rule_day->id);
+	}
+
+	for (n = 0; n < 24; n++)
+	{
+		_solar_term_date(year, n, &y, &m, &d);
+		julian = _holiday_julian(y, m, d);
+		if (julian >= first && julian <= last)
+			_holiday_add(array, julian, LUNAR_HOLIDAY_ID(LUNAR_HOLIDAY_KIND_TERM, 0, n, 0));
+	}
+}
+
+/* [LUNAR] of a lunar year, the leap month has the holidays of its month */
+static void _holiday_lunar_year (LunarHolidayDb *db, gint year,
+		guint32 first, guint32 last, GArray *array)
+{
+	guint month_days[NUM_OF_MONTHS + 1];
+	gint i, month, day, leap_month;
+	guint32 julian;
+
+	julian = _lunar_year_start[year - BEGIN_YEAR] + LUNAR_DAYS_JULIAN;
+	leap_month = _lunar_make_month_days(year - BEGIN_YEAR, month_days);
+	for (i = 1; i <= NUM_OF_MONTHS; i++)
+	{
+		if (month_days[i] == 0)
+			break;
+		month = (leap_month > 0 && i > leap_month) ? i - 1 : i;
+		if (julian <= last && julian + month_days[i] > first)
+		{
+			for (day = 1; day <= (gint) month_days[i]; day++)
+			{
+				if (db->lunar[month][day] > LUNAR_HOLIDAY_DB_REMOVED
+						&& julian + day - 1 >= first && julian + day - 1 <= last)
+					_holiday_add(array, julian + day - 1, LUNAR_HOLIDAY_ID(LUNAR_HOLIDAY_KIND_LUNAR, month, day, 0));
+			}
+		}
+		julian += month_days[i];
+	}
+}
+
+/* The name of @id in @db, NULL if it has none. */
+static const gchar* _holiday_name (LunarHolidayDb *db, guint32 id)
+{
+	LunarHolidayRule *rule;
+	guint month, a, b, i;
+
+	month = LUNAR_HOLIDAY_ID_MONTH(id);
+	a = LUNAR_HOLIDAY_ID_A(id);
+	b = LUNAR_HOLIDAY_ID_B(id);
+	if (LUNAR_HOLIDAY_ID_KIND(id) == LUNAR_HOLIDAY_KIND_TERM)
+		return (month == 0 && a < 24 && b == 0) ? _solar_term_name(a) : NULL;
+	if (LUNAR_HOLIDAY_ID_KIND(id) <= LUNAR_HOLIDAY_KIND_WEEK && (month < 1 || month > 12))
+		return NULL;
+
+	switch (LUNAR_HOLIDAY_ID_KIND(id))
+	{
+		case LUNAR_HOLIDAY_KIND_SOLAR:
+			if (a >= 1 && a <= 31 && b == 0)
+				return _lunar_holiday_db_solar(db, month, a);
+			break;
+		case LUNAR_HOLIDAY_KIND_LUNAR:
+			if (a >= 1 && a <= 30 && b == 0)
+				return _lunar_holiday_db_lunar(db, month, a);
+			break;
+		case LUNAR_HOLIDAY_KIND_WEEK:
+			if (a >= 1 && a <= 5 && b <= 6)
+				return _lunar_holiday_db_week(db, month, a, b);
+			break;
+		default:
+			for (i = 0; i < db->rules->len; i++)
+			{
+				rule = &g_array_index(db->rules, LunarHolidayRule, i);
+				if (rule->id == id)
+					return _lunar_holiday_db_name(db, rule->name);
+			}
+			break;
+	}
+	return NULL;
+}
+
+/*
+ * Drops the holidays named like an earlier one of the same day, the one
+ * of the highest kind stays.  A user file may still carry an entry the
+ * defaults now have as a rule, as [LUNAR] 1230 for [RULE] L12-1.
+ */
+static void _holiday_dedupe (LunarHolidayDb *db, GArray *array)
+{
+	LunarHolidayOccurrence *o, *p;
+	gboolean dup;
+	guint i, j, k;
+
+	for (i = 1, k = 1; i < array->len; i++)
+	{
+		o = &g_array_index(array, LunarHolidayOccurrence, i);
+		dup = FALSE;
+		for (j = k; j > 0 && !dup; j--)
+		{
+			p = &g_array_index(array, LunarHolidayOccurrence, j - 1);
+			if (p->julian != o->julian)
+				break;
+			dup = g_strcmp0(_holiday_name(db, p->id), _holiday_name(db, o->id)) == 0;
+		}
+		if (!dup)
+			g_array_index(array, LunarHolidayOccurrence, k++) = *o;
+	}
+	if (k < array->len)
+		g_array_set_size(array, k);
+}
+
+/* Adds the holidays from @first to @last, which must be in the tables, sorted. */
+static void _holiday_collect (LunarHolidayDb *db, guint32 first, guint32 last, GArray *array)
+{
+	gint year, month, day, first_year, last_year;
+	gboolean isleap;
+
+	_lunar_from_days(first - LUNAR_DAYS_JULIAN, &first_year, &month, &day, &isleap);
+	_lunar_from_days(last - LUNAR_DAYS_JULIAN, &last_year, &month, &day, &isleap);
+	for (year = first_year; year <= last_year; year++)
+		_holiday_lunar_year(db, year, first, last, array);
+
+	for (year = _holiday_year(first); year <= _holiday_year(last); year++)
+		_holiday_solar_year(db, year, first, last, array);
+
+	g_array_sort(array, _holiday_compare);
+	_holiday_dedupe(db, array);
+}
+
+/**
+ * lunar_holidays_in_range:
+ * @start: the first day.
+ * @end: the last day.
+ *
+ * Lists the holidays and solar terms from @start to @end, the same as
+ * lunar_date_get_jieri() for each of the days would.  Days out of the
+ * supported years are skipped.
+ *
+ * Return value: (transfer full) (element-type LunarHolidayOccurrence): a
+ * newly-allocated array of #LunarHolidayOccurrence sorted by date, the
+ * holidays of a day in the order of lunar_date_get_jieri().
+ **/
+GArray* lunar_holidays_in_range (const GDate *start, const GDate *end)
+{
+	LunarHolidaySet *set;
+	GArray *array;
+	guint32 first, last;
+	gint ticket;
+
+	g_return_val_if_fail(g_date_valid(start), NULL);
+	g_return_val_if_fail(g_date_valid(end), NULL);
+
+	_lunar_date_init_i18n();
+	_lunar_tables_init();
+	array = g_array_new(FALSE, FALSE, sizeof(LunarHolidayOccurrence));
+	first = MAX(g_date_get_julian(start), LUNAR_DAYS_JULIAN);
+	last = MIN(g_date_get_julian(end), LUNAR_DAYS_JULIAN + _lunar_year_start[NUM_OF_YEARS] - 1);
+	if (first > last)
+		return array;
+
+	set = _lunar_holiday_set_peek();
+	_holiday_collect(_lunar_holiday_set_acquire(set, &ticket), first, last, array);
+	_lunar_holiday_set_release(set, ticket);
+	return array;
+}
+
+G_LOCK_DEFINE_STATIC (holiday_records);
+static GHashTable *holiday_records = NULL;
+
+static guint _holiday_record_hash (gconstpointer key)
+{
+	const LunarHoliday *holiday = key;
+
+	return holiday->id ^ g_str_hash(holiday->name);
+}
+
+static gboolean _holiday_record_equal (gconstpointer a, gconstpointer b)
+{
+	const LunarHoliday *holiday_a = a;
+	const LunarHoliday *holiday_b = b;
+
+	return holiday_a->id == holiday_b->id && strcmp(holiday_a->name, holiday_b->name) == 0;
+}
+
+/*
+ * The record of holiday @id named @name.  The records are kept for the
+ * life of the process, there are a few for each holiday and language
+ * in use.
+ */
+static const LunarHoliday* _holiday_record (guint32 id, const gchar *name)
+{
+	LunarHoliday key, *holiday;
+	gchar *short_name;
+
+	key.id = id;
+	key.name = name;
+	G_LOCK (holiday_records);
+	if (holiday_records == NULL)
+		holiday_records = g_hash_table_new(_holiday_record_hash, _holiday_record_equal);
+	holiday = g_hash_table_lookup(holiday_records, &key);
+	if (holiday == NULL)
+	{
+		/* 3 Chinese characters, or 4 bytes of a name that is not UTF-8 */
+		if (g_utf8_validate(name, -1, NULL))
+			short_name = g_strndup(name, g_utf8_offset_to_pointer(name, MIN(g_utf8_strlen(name, -1), 3)) - name);
+		else
+			short_name = g_strndup(name, 4);
+
+		holiday = g_new(LunarHoliday, 1);
+		holiday->id = id;
+		holiday->kind = LUNAR_HOLIDAY_ID_KIND(id);
+		holiday->name = g_intern_string(name);
+		holiday->short_name = g_intern_string(short_name);
+		holiday->priority = _lunar_holiday_kind_order[holiday->kind];
+		g_hash_table_insert(holiday_records, holiday, holiday);
+		g_free(short_name);
+	}
+	G_UNLOCK (holiday_records);
+	return holiday;
+}
+
+/**
+ * _lunar_holiday_db_year:
+ *
+ * Returns the holidays of each day of a solar year, in the order of
+ * lunar_date_get_jieri().  The table is built on first use, then
+ * published in @db and never changed, so later lookups are one atomic
+ * load without a lock or a reference.
+ *
+ * Return value: the table, owned by @db, or %NULL if @year is out of
+ * range.
+ **/
+const LunarHolidayYear* _lunar_holiday_db_year (LunarHolidayDb *db, gint year)
+{
+	LunarHolidayYear *table, **slot;
+	LunarHolidayOccurrence *occurrence;
+	GArray *array;
+	guint32 first, last;
+	guint i, day;
+
+	if (year < BEGIN_YEAR || year >= BEGIN_YEAR + LUNAR_HOLIDAY_YEARS)
+		return NULL;
+
+	slot = &db->years[year - BEGIN_YEAR];
+	table = g_atomic_pointer_get(slot);
+	if (table != NULL)
+		return table;
+
+	/* only one thread builds a year, the others wait for it */
+	g_mutex_lock(&db->year_lock);
+	table = g_atomic_pointer_get(slot);
+	if (table != NULL)
+	{
+		g_mutex_unlock(&db->year_lock);
+		return table;
+	}
+
+	_lunar_tables_init();
+	first = _holiday_julian(year, 1, 1);
+	last = _holiday_julian(year, 12, 31);
+	array = g_array_new(FALSE, FALSE, sizeof(LunarHolidayOccurrence));
+	if (first < LUNAR_DAYS_JULIAN + _lunar_year_start[NUM_OF_YEARS] && last >= LUNAR_DAYS_JULIAN)
+		_holiday_collect(db, MAX(first, LUNAR_DAYS_JULIAN),
+				MIN(last, LUNAR_DAYS_JULIAN + _lunar_year_start[NUM_OF_YEARS] - 1), array);
+
+	table = g_malloc(sizeof(LunarHolidayYear) + array->len * sizeof(LunarHoliday *));
+	table->year = year;
+	table->julian = first;
+	for (i = 0, day = 0; i < array->len; i++)
+	{
+		occurrence = &g_array_index(array, LunarHolidayOccurrence, i);
+		while (day <= occurrence->julian - first)
+			table->offsets[day++] = i;
+		table->entries[i] = _holiday_record(occurrence->id, _holiday_name(db, occurrence->id));
+	}
+	while (day < G_N_ELEMENTS(table->offsets))
+		table->offsets[day++] = array->len;
+	g_array_free(array, TRUE);
+
+	g_atomic_pointer_compare_and_exchange(slot, NULL, table);
+	g_mutex_unlock(&db->year_lock);
+	return table;
+}
+
+/* The holiday id of @name in @db, 0 if there is none. */
+static guint32 _holiday_lookup (LunarHolidayDb *db, const gchar *name)
+{
+	guint32 id;
+	gint n;
+
+	id = GPOINTER_TO_UINT(g_hash_table_lookup(db->index, name));
+	if (id != 0)
+		return id;
+	for (n = 0; n < 24; n++)
+	{
+		if (strcmp(_solar_term_name(n), name) == 0)
+			return LUNAR_HOLIDAY_ID(LUNAR_HOLIDAY_KIND_TERM, 0, n, 0);
+	}
+	return 0;
+}
+
+/*
+ * The first day of @id in the solar year, 0 if there is none.  A lunar
+ * holiday may fall on a day of lunar year - 1 or of the lunar year, in
+ * its month or the leap month of it.
+ */
+static guint32 _holiday_find (LunarHolidayDb *db, guint32 id, gint year)
+{
+	gint month, a, b, y, m, d, leap_month, i;
+	guint month_days[NUM_OF_MONTHS + 1];
+	guint32 julian, found = 0;
+	GArray *rule_days;
+	glong days;
+
+	if (_holiday_name(db, id) == NULL || year < BEGIN_YEAR || year > BEGIN_YEAR + NUM_OF_YEARS)
+		return 0;
+
+	month = LUNAR_HOLIDAY_ID_MONTH(id);
+	a = LUNAR_HOLIDAY_ID_A(id);
+	b = LUNAR_HOLIDAY_ID_B(id);
+	switch (LUNAR_HOLIDAY_ID_KIND(id))
+	{
+		case LUNAR_HOLIDAY_KIND_SOLAR:
+			if (g_date_valid_dmy(a, month, year))
+				found = _holiday_julian(year, month, a);
+			break;
+		case LUNAR_HOLIDAY_KIND_WEEK:
+			d = _holiday_week_day(year, month, a, b);
+			if (d != 0)
+				found = _holiday_julian(year, month, d);
+			break;
+		case LUNAR_HOLIDAY_KIND_TERM:
+			_solar_term_date(year, a, &y, &m, &d);
+			found = _holiday_julian(y, m, d);
+			break;
+		case LUNAR_HOLIDAY_KIND_LUNAR:
+			for (y = year - 1; y <= year && found == 0; y++)
+			{
+				if (y < BEGIN_YEAR || y >= BEGIN_YEAR + NUM_OF_YEARS)
+					continue;
+				leap_month = _lunar_make_month_days(y - BEGIN_YEAR, month_days);
+				for (i = 0; i < (leap_month == month ? 2 : 1); i++)
+				{
+					days = _lunar_to_days(y, month, a, i, NULL);
+					if (days < 0)
+						continue;
+					julian = days + LUNAR_DAYS_JULIAN;
+					if (_holiday_year(julian) == year)
+					{
+						found = julian;
+						break;
+					}
+				}
+			}
+			break;
+		default:
+			rule_days = _lunar_holiday_db_rule_days(db, year);
+			for (i = 0; rule_days != NULL && i < (gint) rule_days->len; i++)
+			{
+				if (g_array_index(rule_days, LunarHolidayRuleDay, i).id == id)
+				{
+					found = g_array_index(rule_days, LunarHolidayRuleDay, i).julian;
+					break;
+				}
+			}
+			break;
+	}
+	return found;
+}
+
+/**
+ * lunar_holiday_get_name:
+ * @id: a holiday id, from a #LunarHolidayOccurrence.
+ *
+ * Looks up the name of a holiday in the current language.
+ *
+ * Return value: a newly-allocated name, or %NULL if there is no such
+ * holiday.
+ **/
+gchar* lunar_holiday_get_name (guint32 id)
+{
+	LunarHolidaySet *set;
+	gchar *name;
+	gint ticket;
+
+	_lunar_date_init_i18n();
+	set = _lunar_holiday_set_peek();
+	name = g_strdup(_holiday_name(_lunar_holiday_set_acquire(set, &ticket), id));
+	_lunar_holiday_set_release(set, ticket);
+	return name;
+}
+
+/**
+ * lunar_holiday_lookup:
+ * @name: the name of a holiday or a solar term, in the current language.
+ *
+ * Looks up the id of a holiday by its name.  If several holidays have
+ * the name, the lunar one comes first, then the solar one, then the
+ * one on a weekday.
+ *
+ * Return value: the holiday id, 0 if there is no such holiday.
+ **/
+guint32 lunar_holiday_lookup (const gchar *name)
+{
+	LunarHolidaySet *set;
+	guint32 id;
+	gint ticket;
+
+	g_return_val_if_fail(name != NULL, 0);
+
+	_lunar_date_init_i18n();
+	set = _lunar_holiday_set_peek();
+	id = _holiday_lookup(_lunar_holiday_set_acquire(set, &ticket), name);
+	_lunar_holiday_set_release(set, ticket);
+	return id;
+}
+
+/**
+ * lunar_holiday_find_id:
+ * @id: a holiday id.
+ * @year: a solar year.
+ * @date: return location for the day.
+ *
+ * Finds the day of a holiday in a solar year.  The holiday may fall on
+ * two days of the year, a lunar one in January and December, then the
+ * first is returned.
+ *
+ * Return value: %TRUE if @date was set, %FALSE if the holiday does not
+ * fall in @year.
+ **/
+gboolean lunar_holiday_find_id (guint32 id, GDateYear year, GDate *date)
+{
+	LunarHolidaySet *set;
+	guint32 julian;
+	gint ticket;
+
+	g_return_val_if_fail(date != NULL, FALSE);
+
+	_lunar_tables_init();
+	set = _lunar_holiday_set_peek();
+	julian = _holiday_find(_lunar_holiday_set_acquire(set, &ticket), id, year);
+	_lunar_holiday_set_release(set, ticket);
+	if (julian == 0)
+		return FALSE;
+	g_date_set_julian(date, julian);
+	return TRUE;
+}
+
+/**
+ * lunar_holiday_find:
+ * @name: the name of a holiday or a solar term, in the current language.
+ * @year: a solar year.
+ * @date: return location for the day.
+ *
+ * Finds the day of a holiday in a solar year by its name, see
+ * lunar_holiday_lookup() and lunar_holiday_find_id().  If the holiday
+ * it finds does not fall in @year, the [RULE] holidays of the same name
+ * are tried, as a [LUNAR] 1230 left in a user file for the L12-1 rule.
+ *
+ * Return value: %TRUE if @date was set, %FALSE if there is no such
+ * holiday or it does not fall in @year.
+ **/
+gboolean lunar_holiday_find (const gchar *name, GDateYear year, GDate *date)
+{
+	LunarHolidaySet *set;
+	LunarHolidayDb *db;
+	LunarHolidayRule *rule;
+	guint32 julian = 0;
+	guint32 id;
+	gint ticket;
+	guint i;
+
+	g_return_val_if_fail(name != NULL, FALSE);
+	g_return_val_if_fail(date != NULL, FALSE);
+
+	_lunar_date_init_i18n();
+	_lunar_tables_init();
+	set = _lunar_holiday_set_peek();
+	db = _lunar_holiday_set_acquire(set, &ticket);
+	id = _holiday_lookup(db, name);
+	if (id != 0)
+		julian = _holiday_find(db, id, year);
+	for (i = 0; id != 0 && julian == 0 && i < db->rules->len; i++)
+	{
+		rule = &g_array_index(db->rules, LunarHolidayRule, i);
+		if (rule->id != id && g_strcmp0(_lunar_holiday_db_name(db, rule->name), name) == 0)
+			julian = _holiday_find(db, rule->id, year);
+	}
+	_lunar_holiday_set_release(set, ticket);
+	if (julian == 0)
+		return FALSE;
+	g_date_set_julian(date, julian);
+	return TRUE;
+}
+
+/*
+vi:ts=4:wrap:ai:
+*/
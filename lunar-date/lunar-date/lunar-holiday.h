@@ -0,0 +1,122 @@
+/* vi: set sw=4 ts=4: */
+/*
+ * lunar-holiday.h
+ *
+ * This file is part of liblunar.
+ *
+ * Copyright (C) 2007-2011 yetist <yetist@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ * */
+
+#ifndef __LUNAR_HOLIDAY_H__
+#define __LUNAR_HOLIDAY_H__  1
+
+#include	<glib-object.h>
+
+G_BEGIN_DECLS
+
+typedef struct _LunarHolidayOccurrence	  LunarHolidayOccurrence;
+typedef struct _LunarHoliday			  LunarHoliday;
+
+/**
+ * LunarHolidayKind:
+ * @LUNAR_HOLIDAY_KIND_SOLAR: a holiday on a fixed solar date.
+ * @LUNAR_HOLIDAY_KIND_LUNAR: a holiday on a fixed lunar date.
+ * @LUNAR_HOLIDAY_KIND_WEEK: a holiday on the nth weekday of a solar month.
+ * @LUNAR_HOLIDAY_KIND_TERM: a solar term.
+ * @LUNAR_HOLIDAY_KIND_LUNAR_LAST: a holiday counted from the end of a
+ * lunar month.
+ * @LUNAR_HOLIDAY_KIND_WEEK_LAST: a holiday on the last weekday of a solar
+ * month.
+ * @LUNAR_HOLIDAY_KIND_TERM_DAYS: a holiday some days from a solar term.
+ * @LUNAR_HOLIDAY_KIND_DATE: a holiday in one year only.
+ */
+typedef enum
+{
+	LUNAR_HOLIDAY_KIND_SOLAR = 1,
+	LUNAR_HOLIDAY_KIND_LUNAR,
+	LUNAR_HOLIDAY_KIND_WEEK,
+	LUNAR_HOLIDAY_KIND_TERM,
+	LUNAR_HOLIDAY_KIND_LUNAR_LAST,
+	LUNAR_HOLIDAY_KIND_WEEK_LAST,
+	LUNAR_HOLIDAY_KIND_TERM_DAYS,
+	LUNAR_HOLIDAY_KIND_DATE
+} LunarHolidayKind;
+
+/**
+ * LunarHoliday:
+ * @id: the holiday id, see lunar_holiday_get_name().
+ * @kind: the #LunarHolidayKind of the holiday.
+ * @name: the name of the holiday.
+ * @short_name: the name cut to 3 characters, as %(jieri) shows it.
+ * @priority: the rank of the holiday among those of a day, the lower
+ * ones come first.
+ *
+ * A holiday, as lunar_date_get_holidays() returns it.  The records are
+ * shared and never change or go away, so they are handed out without
+ * a reference.  When the holiday files change, the new names come in
+ * new records.
+ */
+struct _LunarHoliday
+{
+	guint32				id;
+	LunarHolidayKind	kind;
+	const gchar		   *name;
+	const gchar		   *short_name;
+	guint				priority;
+};
+
+/**
+ * LunarHolidayOccurrence:
+ * @julian: the solar date, as returned by g_date_get_julian().
+ * @id: the holiday, see lunar_holiday_get_name().
+ * @lunar_year: the lunar year of the date.
+ * @lunar_month: the lunar month of the date.
+ * @lunar_day: the lunar day of the date.
+ * @lunar_isleap: whether @lunar_month is a leap month.
+ * @kind: the #LunarHolidayKind of the holiday.
+ *
+ * One day of a holiday.  The id stands for the rule the holiday is
+ * defined by, for example the 15th day of the 8th lunar month, so it
+ * does not change when the holiday files are reloaded or the language
+ * changes.
+ */
+struct _LunarHolidayOccurrence
+{
+	guint32		julian;
+	guint32		id;
+	guint16		lunar_year;
+	guint8		lunar_month;
+	guint8		lunar_day;
+	guint8		lunar_isleap;
+	guint8		kind;
+};
+
+GArray*		lunar_holidays_in_range		  (const GDate *start,
+											const GDate *end);
+gchar*		lunar_holiday_get_name		  (guint32 id);
+guint32		lunar_holiday_lookup		  (const gchar *name);
+gboolean	lunar_holiday_find			  (const gchar *name,
+											GDateYear year,
+											GDate *date);
+gboolean	lunar_holiday_find_id		  (guint32 id,
+											GDateYear year,
+											GDate *date);
+
+G_END_DECLS
+
+#endif /*__LUNAR_HOLIDAY_H__ */
@@ -0,0 +1,315 @@
+/* vi: set sw=4 ts=4: */
+/*
+ * lunar-ical.c
+ *
+ * This file is part of liblunar.
+ *
+ * Copyright (C) 2007-2011 yetist <yetist@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ * */
+
+#if HAVE_CONFIG_H
+	#include <config.h>
+#endif
+#include <string.h>
+#include <lunar-date/lunar-ical.h>
+#include <lunar-date/lunar-version.h>
+
+/**
+ * SECTION:lunar-ical
+ * @Short_description: iCalendar export
+ * @Title: iCalendar
+ *
+ * Writes the holidays, the solar terms or the days of a
+ * #LunarRecurrence as an RFC 5545 calendar of all-day events, to
+ * publish a calendar other programs can subscribe to.  The events are
+ * written a year at a time through a small buffer, so the memory used
+ * does not grow with the years.  The UID of an event is made of its
+ * date and of the holiday id, or of the rule and the summary, so it
+ * stays the same when the calendar is written again.
+ */
+
+/* the bytes kept before writing them to the stream */
+#define ICAL_BUFFER_SIZE	8192
+/* the longest line, longer ones are folded */
+#define ICAL_LINE_OCTETS	75
+
+typedef struct
+{
+	GOutputStream	*stream;
+	GCancellable	*cancellable;
+	GString			*buffer;
+	gchar			 stamp[17];
+} IcalWriter;
+
+static void _ical_writer_init (IcalWriter *writer, GOutputStream *stream, GCancellable *cancellable)
+{
+	GDateTime *now;
+	gchar *stamp;
+
+	writer->stream = stream;
+	writer->cancellable = cancellable;
+	writer->buffer = g_string_sized_new(ICAL_BUFFER_SIZE + 1024);
+	now = g_date_time_new_now_utc();
+	stamp = g_date_time_format(now, "%Y%m%dT%H%M%SZ");
+	g_strlcpy(writer->stamp, stamp, sizeof(writer->stamp));
+	g_free(stamp);
+	g_date_time_unref(now);
+}
+
+/* Writes out the buffer once it is full, or if @force. */
+static gboolean _ical_flush (IcalWriter *writer, gboolean force, GError **error)
+{
+	gboolean ret;
+
+	if (writer->buffer->len < ICAL_BUFFER_SIZE && !force)
+		return TRUE;
+	ret = g_output_stream_write_all(writer->stream, writer->buffer->str, writer->buffer->len,
+			NULL, writer->cancellable, error);
+	g_string_truncate(writer->buffer, 0);
+	return ret;
+}
+
+/*
+ * Appends the content line @name:@value, escaping @value if @text, and
+ * folds it at ICAL_LINE_OCTETS, never inside a UTF-8 character.
+ */
+static void _ical_line (IcalWriter *writer, const gchar *name, const gchar *value, gboolean text)
+{
+	GString *buffer = writer->buffer;
+	gsize start, end;
+	const gchar *p;
+
+	start = buffer->len;
+	g_string_append(buffer, name);
+	g_string_append_c(buffer, ':');
+	for (p = value; *p != '\0'; p++)
+	{
+		if (text && (*p == '\\' || *p == ';' || *p == ','))
+			g_string_append_c(buffer, '\\');
+		/* CRLF, CR and LF alike are line breaks, escaped */
+		if (text && *p == '\r' && p[1] == '\n')
+			continue;
+		if (text && (*p == '\n' || *p == '\r'))
+			g_string_append(buffer, "\\n");
+		else
+			g_string_append_c(buffer, *p);
+	}
+
+	/* the lines after the first begin with a space, which counts */
+	while (buffer->len - start > ICAL_LINE_OCTETS)
+	{
+		end = start + ICAL_LINE_OCTETS;
+		while (((guchar) buffer->str[end] & 0xc0) == 0x80)
+			end--;
+		g_string_insert_len(buffer, end, "\r\n ", 3);
+		start = end + 2;
+	}
+	g_string_append(buffer, "\r\n");
+}
+
+static void _ical_date_line (IcalWriter *writer, const gchar *name, guint32 julian)
+{
+	GDate date;
+	gchar value[9];
+
+	g_date_clear(&date, 1);
+	g_date_set_julian(&date, julian);
+	g_snprintf(value, sizeof(value), "%04d%02d%02d",
+			g_date_get_year(&date), g_date_get_month(&date), g_date_get_day(&date));
+	_ical_line(writer, name, value, FALSE);
+}
+
+static void _ical_begin (IcalWriter *writer)
+{
+	gchar *prodid;
+
+	prodid = g_strdup_printf("-//liblunar//lunar-date %d.%d.%d//EN",
+			LUNAR_DATE_MAJOR_VERSION, LUNAR_DATE_MINOR_VERSION, LUNAR_DATE_MICRO_VERSION);
+	_ical_line(writer, "BEGIN", "VCALENDAR", FALSE);
+	_ical_line(writer, "VERSION", "2.0", FALSE);
+	_ical_line(writer, "PRODID", prodid, FALSE);
+	_ical_line(writer, "CALSCALE", "GREGORIAN", FALSE);
+	g_free(prodid);
+}
+
+/* Appends an all-day event on day @julian. */
+static void _ical_event (IcalWriter *writer, guint32 julian, guint32 uid,
+		const gchar *summary, const gchar *category)
+{
+	GDate date;
+	gchar value[64];
+
+	g_date_clear(&date, 1);
+	g_date_set_julian(&date, julian);
+	g_snprintf(value, sizeof(value), "%04d%02d%02d-%08x@liblunar",
+			g_date_get_year(&date), g_date_get_month(&date), g_date_get_day(&date), uid);
+	_ical_line(writer, "BEGIN", "VEVENT", FALSE);
+	_ical_line(writer, "UID", value, FALSE);
+	_ical_line(writer, "DTSTAMP", writer->stamp, FALSE);
+	_ical_date_line(writer, "DTSTART;VALUE=DATE", julian);
+	_ical_date_line(writer, "DTEND;VALUE=DATE", julian + 1);
+	_ical_line(writer, "SUMMARY", summary, TRUE);
+	if (category != NULL)
+		_ical_line(writer, "CATEGORIES", category, TRUE);
+	_ical_line(writer, "TRANSP", "TRANSPARENT", FALSE);
+	_ical_line(writer, "END", "VEVENT", FALSE);
+}
+
+/* Writes the rest of the buffer and the end of the calendar. */
+static gboolean _ical_end (IcalWriter *writer, gboolean ret, GError **error)
+{
+	if (ret)
+	{
+		_ical_line(writer, "END", "VCALENDAR", FALSE);
+		ret = _ical_flush(writer, TRUE, error);
+	}
+	g_string_free(writer->buffer, TRUE);
+	return ret;
+}
+
+/**
+ * lunar_ical_write:
+ * @stream: a #GOutputStream
+ * @start_year: the first solar year.
+ * @end_year: the last solar year.
+ * @flags: what to write.
+ * @cancellable: (allow-none): optional #GCancellable object, %NULL to ignore.
+ * @error: location to store the error occuring, or %NULL to ignore errors.
+ *
+ * Writes an iCalendar with an event for each holiday or solar term, as
+ * lunar_holidays_in_range() lists them, from @start_year to @end_year.
+ * The names are in the current language.  The stream is not closed.
+ *
+ * Return value: %TRUE on success, %FALSE if there was an error.
+ **/
+gboolean lunar_ical_write (GOutputStream *stream, GDateYear start_year, GDateYear end_year,
+		LunarIcalFlags flags, GCancellable *cancellable, GError **error)
+{
+	IcalWriter writer;
+	LunarHolidayOccurrence *occurrence;
+	GArray *array;
+	GDate start, end;
+	gboolean ret = TRUE;
+	gboolean term;
+	gchar *name;
+	guint year, i;
+
+	g_return_val_if_fail(G_IS_OUTPUT_STREAM(stream), FALSE);
+	g_return_val_if_fail(g_date_valid_year(start_year), FALSE);
+	g_return_val_if_fail(g_date_valid_year(end_year), FALSE);
+
+	_ical_writer_init(&writer, stream, cancellable);
+	_ical_begin(&writer);
+	g_date_clear(&start, 1);
+	g_date_clear(&end, 1);
+	for (year = start_year; year <= end_year && ret; year++)
+	{
+		g_date_set_dmy(&start, 1, G_DATE_JANUARY, year);
+		g_date_set_dmy(&end, 31, G_DATE_DECEMBER, year);
+		array = lunar_holidays_in_range(&start, &end);
+		for (i = 0; i < array->len && ret; i++)
+		{
+			occurrence = &g_array_index(array, LunarHolidayOccurrence, i);
+			term = occurrence->kind == LUNAR_HOLIDAY_KIND_TERM;
+			if (!(flags & (term ? LUNAR_ICAL_TERMS : LUNAR_ICAL_HOLIDAYS)))
+				continue;
+			name = lunar_holiday_get_name(occurrence->id);
+			if (name != NULL)
+				_ical_event(&writer, occurrence->julian, occurrence->id, name,
+						term ? "SOLAR TERM" : "HOLIDAY");
+			g_free(name);
+			ret = _ical_flush(&writer, FALSE, error);
+		}
+		g_array_free(array, TRUE);
+	}
+	return _ical_end(&writer, ret, error);
+}
+
+/* The UID of the events of @rule, two rules of one summary differ. */
+static guint32 _ical_rule_uid (const LunarRecurrence *rule, const gchar *summary)
+{
+	guint32 uid;
+
+	uid = g_str_hash(summary);
+	uid = uid * 31 + rule->freq;
+	uid = uid * 31 + rule->month;
+	uid = uid * 31 + rule->days;
+	uid = uid * 31 + rule->months;
+	uid = uid * 31 + rule->clamp;
+	return uid;
+}
+
+/**
+ * lunar_ical_write_recurrence:
+ * @stream: a #GOutputStream
+ * @rule: a #LunarRecurrence
+ * @summary: the title of the events.
+ * @start: a valid #GDate, the first day.
+ * @end: a valid #GDate, the last day.
+ * @cancellable: (allow-none): optional #GCancellable object, %NULL to ignore.
+ * @error: location to store the error occuring, or %NULL to ignore errors.
+ *
+ * Writes an iCalendar with an event called @summary for each day of
+ * @rule from @start to @end, as lunar_recurrence_expand() lists them.
+ * An RRULE cannot follow the lunar months, so each day is an event of
+ * its own.  The stream is not closed.
+ *
+ * Return value: %TRUE on success, %FALSE if there was an error.
+ **/
+gboolean lunar_ical_write_recurrence (GOutputStream *stream, const LunarRecurrence *rule,
+		const gchar *summary, const GDate *start, const GDate *end,
+		GCancellable *cancellable, GError **error)
+{
+	IcalWriter writer;
+	GArray *julians;
+	GDate first, last;
+	gboolean ret = TRUE;
+	guint year, uid, i;
+
+	g_return_val_if_fail(G_IS_OUTPUT_STREAM(stream), FALSE);
+	g_return_val_if_fail(rule != NULL, FALSE);
+	g_return_val_if_fail(summary != NULL, FALSE);
+	g_return_val_if_fail(g_date_valid(start), FALSE);
+	g_return_val_if_fail(g_date_valid(end), FALSE);
+
+	_ical_writer_init(&writer, stream, cancellable);
+	_ical_begin(&writer);
+	uid = _ical_rule_uid(rule, summary);
+	julians = g_array_new(FALSE, FALSE, sizeof(guint32));
+	g_date_clear(&first, 1);
+	g_date_clear(&last, 1);
+	for (year = g_date_get_year(start); year <= g_date_get_year(end) && ret; year++)
+	{
+		g_date_set_dmy(&first, 1, G_DATE_JANUARY, year);
+		g_date_set_dmy(&last, 31, G_DATE_DECEMBER, year);
+		lunar_recurrence_expand(rule, g_date_compare(start, &first) > 0 ? start : &first,
+				g_date_compare(end, &last) < 0 ? end : &last, julians);
+		for (i = 0; i < julians->len && ret; i++)
+		{
+			_ical_event(&writer, g_array_index(julians, guint32, i), uid, summary, NULL);
+			ret = _ical_flush(&writer, FALSE, error);
+		}
+		g_array_set_size(julians, 0);
+	}
+	g_array_free(julians, TRUE);
+	return _ical_end(&writer, ret, error);
+}
+
+/*
+vi:ts=4:wrap:ai:
+*/
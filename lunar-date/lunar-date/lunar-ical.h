@@ -0,0 +1,62 @@
+/* vi: set sw=4 ts=4: */
+/*
+ * lunar-ical.h
+ *
+ * This file is part of liblunar.
+ *
+ * Copyright (C) 2007-2011 yetist <yetist@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ * */
+
+#ifndef __LUNAR_ICAL_H__
+#define __LUNAR_ICAL_H__  1
+
+#include	<gio/gio.h>
+#include	<lunar-date/lunar-recurrence.h>
+
+G_BEGIN_DECLS
+
+/**
+ * LunarIcalFlags:
+ * @LUNAR_ICAL_HOLIDAYS: the holidays.
+ * @LUNAR_ICAL_TERMS: the solar terms.
+ *
+ * What lunar_ical_write() writes.
+ */
+typedef enum
+{
+	LUNAR_ICAL_HOLIDAYS = 1 << 0,
+	LUNAR_ICAL_TERMS = 1 << 1
+} LunarIcalFlags;
+
+gboolean	lunar_ical_write			  (GOutputStream *stream,
+												GDateYear start_year,
+												GDateYear end_year,
+												LunarIcalFlags flags,
+												GCancellable *cancellable,
+												GError **error);
+gboolean	lunar_ical_write_recurrence	  (GOutputStream *stream,
+												const LunarRecurrence *rule,
+												const gchar *summary,
+												const GDate *start,
+												const GDate *end,
+												GCancellable *cancellable,
+												GError **error);
+
+G_END_DECLS
+
+#endif /*__LUNAR_ICAL_H__ */
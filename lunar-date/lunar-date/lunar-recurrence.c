@@ -0,0 +1,144 @@
+/* vi: set sw=4 ts=4: */
+/*
+ * lunar-recurrence.c
+ *
+ * This file is part of liblunar.
+ *
+ * Copyright (C) 2007-2011 yetist <yetist@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ * */
+
+#if HAVE_CONFIG_H
+	#include <config.h>
+#endif
+#include <lunar-date/lunar-recurrence.h>
+#include "lunar-date-private.h"
+
+/**
+ * SECTION:lunar-recurrence
+ * @Short_description: Lunar dates that come back
+ * @Title: Recurrences
+ *
+ * A #LunarRecurrence is a rule like "every year on the 15th day of the
+ * first month" or "on the 1st and 15th day of every month", and
+ * lunar_recurrence_expand() lists its days in a span of solar dates.
+ * The days come from the tables of the first day of each lunar month,
+ * a month at a time, never a day at a time.
+ */
+
+/*
+ * Appends the days of @rule in the month at @ordinal, from day number
+ * @first to @last, to @julians.
+ */
+static guint _recurrence_month (const LunarRecurrence *rule, gint ordinal,
+		glong first, glong last, GArray *julians)
+{
+	glong days;
+	gint month_days, day, prev = 0;
+	guint32 julian;
+	guint n = 0;
+
+	month_days = _lunar_month_days(ordinal);
+	if (_lunar_month_start[ordinal] + month_days <= first)
+		return 0;
+	for (day = g_bit_nth_lsf(rule->days, 0); day >= 0; day = g_bit_nth_lsf(rule->days, day))
+	{
+		if (day > month_days)
+		{
+			if (!(rule->clamp & LUNAR_DATE_CLAMP_DAY))
+				break;
+			day = month_days;
+		}
+		/* day 29 and day 30 clamped to it */
+		if (day == prev)
+			break;
+		prev = day;
+		days = _lunar_month_start[ordinal] + day - 1;
+		if (days > last)
+			break;
+		if (days < first)
+			continue;
+		julian = days + LUNAR_DAYS_JULIAN;
+		g_array_append_val(julians, julian);
+		n++;
+	}
+	return n;
+}
+
+/**
+ * lunar_recurrence_expand:
+ * @rule: a #LunarRecurrence
+ * @start: a valid #GDate, the first day to look at.
+ * @end: a valid #GDate, the last day to look at.
+ * @julians: (element-type guint32): a #GArray of #guint32 to append to.
+ *
+ * Appends the days of @rule from @start to @end, both included, to
+ * @julians, in order, as julian days, see g_date_set_julian().  The
+ * days out of the supported years are left out.
+ *
+ * Return value: the number of days appended.
+ **/
+guint lunar_recurrence_expand (const LunarRecurrence *rule, const GDate *start,
+		const GDate *end, GArray *julians)
+{
+	glong first, last;
+	gint ordinal, year, month, leap_month, normal, leap;
+	gboolean isleap;
+	guint n = 0;
+
+	g_return_val_if_fail(rule != NULL, 0);
+	g_return_val_if_fail(rule->freq != LUNAR_RECURRENCE_YEARLY || (rule->month >= 1 && rule->month <= 12), 0);
+	g_return_val_if_fail(g_date_valid(start), 0);
+	g_return_val_if_fail(g_date_valid(end), 0);
+	g_return_val_if_fail(julians != NULL, 0);
+
+	_lunar_tables_init();
+	first = MAX((glong) g_date_get_julian(start) - LUNAR_DAYS_JULIAN, 0);
+	last = MIN((glong) g_date_get_julian(end) - LUNAR_DAYS_JULIAN, _lunar_year_start[NUM_OF_YEARS] - 1);
+	if (first > last || (rule->days & ~LUNAR_RECURRENCE_DAY(0)) == 0)
+		return 0;
+
+	_lunar_month_from_ordinal(_lunar_month_find(first), &year, &month, &isleap);
+	for (year -= BEGIN_YEAR; year < NUM_OF_YEARS && _lunar_year_start[year] <= last; year++)
+	{
+		leap_month = years_info[year] & 0xf;
+		if (rule->freq == LUNAR_RECURRENCE_MONTHLY)
+		{
+			for (ordinal = _lunar_year_month[year]; ordinal < _lunar_year_month[year + 1]; ordinal++)
+			{
+				/* the leap month comes right after the month it repeats */
+				isleap = leap_month != 0 && ordinal - _lunar_year_month[year] == leap_month;
+				if (rule->months == LUNAR_RECURRENCE_MONTHS_ALL
+						|| (rule->months == LUNAR_RECURRENCE_MONTHS_LEAP) == isleap)
+					n += _recurrence_month(rule, ordinal, first, last, julians);
+			}
+			continue;
+		}
+		normal = _lunar_month_ordinal(year + BEGIN_YEAR, rule->month, FALSE);
+		leap = leap_month == (gint) rule->month ? normal + 1 : -1;
+		if (rule->months != LUNAR_RECURRENCE_MONTHS_LEAP
+				|| (leap < 0 && (rule->clamp & LUNAR_DATE_CLAMP_LEAP)))
+			n += _recurrence_month(rule, normal, first, last, julians);
+		if (rule->months != LUNAR_RECURRENCE_MONTHS_NORMAL && leap >= 0)
+			n += _recurrence_month(rule, leap, first, last, julians);
+	}
+	return n;
+}
+
+/*
+vi:ts=4:wrap:ai:
+*/
@@ -0,0 +1,107 @@
+/* vi: set sw=4 ts=4: */
+/*
+ * lunar-recurrence.h
+ *
+ * This file is part of liblunar.
+ *
+ * Copyright (C) 2007-2011 yetist <yetist@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ * */
+
+#ifndef __LUNAR_RECURRENCE_H__
+#define __LUNAR_RECURRENCE_H__  1
+
+#include	<glib-object.h>
+#include	<lunar-date/lunar-date.h>
+
+G_BEGIN_DECLS
+
+typedef struct _LunarRecurrence			  LunarRecurrence;
+
+/**
+ * LUNAR_RECURRENCE_DAY:
+ * @day: a lunar day, from 1 to 30.
+ *
+ * The bit of @day in the @days of a #LunarRecurrence.
+ */
+#define LUNAR_RECURRENCE_DAY(day)	(1u << (day))
+
+/**
+ * LunarRecurrenceFreq:
+ * @LUNAR_RECURRENCE_YEARLY: every year, in one month.
+ * @LUNAR_RECURRENCE_MONTHLY: every month.
+ *
+ * How often a #LunarRecurrence comes back.
+ */
+typedef enum
+{
+	LUNAR_RECURRENCE_YEARLY,
+	LUNAR_RECURRENCE_MONTHLY
+} LunarRecurrenceFreq;
+
+/**
+ * LunarRecurrenceMonths:
+ * @LUNAR_RECURRENCE_MONTHS_NORMAL: the months that are not leap months.
+ * @LUNAR_RECURRENCE_MONTHS_LEAP: the leap months only.
+ * @LUNAR_RECURRENCE_MONTHS_ALL: both.
+ *
+ * Which months a #LunarRecurrence falls in.
+ */
+typedef enum
+{
+	LUNAR_RECURRENCE_MONTHS_NORMAL,
+	LUNAR_RECURRENCE_MONTHS_LEAP,
+	LUNAR_RECURRENCE_MONTHS_ALL
+} LunarRecurrenceMonths;
+
+/**
+ * LunarRecurrence:
+ * @freq: how often the rule comes back.
+ * @month: the lunar month of a %LUNAR_RECURRENCE_YEARLY rule, from 1 to
+ * 12.
+ * @days: the lunar days of each month, the LUNAR_RECURRENCE_DAY() of
+ * each or-ed together.
+ * @months: whether the leap months count.
+ * @clamp: with %LUNAR_DATE_CLAMP_DAY, day 30 falls on day 29 in the
+ * months of 29 days, and with %LUNAR_DATE_CLAMP_LEAP, a yearly rule on
+ * the leap month falls on the month of the same number in the years
+ * without it.  Otherwise those days are skipped.
+ *
+ * A rule for lunar dates that come back, for example every year on
+ * the 15th day of the first month:
+ *
+ * |[
+ * LunarRecurrence rule = { LUNAR_RECURRENCE_YEARLY, 1, LUNAR_RECURRENCE_DAY(15) };
+ * ]|
+ */
+struct _LunarRecurrence
+{
+	LunarRecurrenceFreq		freq;
+	GDateMonth				month;
+	guint32					days;
+	LunarRecurrenceMonths	months;
+	LunarDateClamp			clamp;
+};
+
+guint		lunar_recurrence_expand		  (const LunarRecurrence *rule,
+												const GDate *start,
+												const GDate *end,
+												GArray *julians);
+
+G_END_DECLS
+
+#endif /*__LUNAR_RECURRENCE_H__ */
@@ -0,0 +1,152 @@
+/* vi: set sw=4 ts=4: */
+/*
+ * lunar-segment.c
+ *
+ * This file is part of liblunar.
+ *
+ * Copyright (C) 2007-2011 yetist <yetist@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ * */
+
+#if HAVE_CONFIG_H
+	#include <config.h>
+#endif
+#include <lunar-date/lunar-segment.h>
+#include "lunar-date-private.h"
+
+/**
+ * SECTION:lunar-segment
+ * @Short_description: Solar ranges cut at the lunar months
+ * @Title: Lunar month segments
+ *
+ * lunar_segments_for_range() cuts a range of solar days where the lunar
+ * months begin, to group data by lunar month without converting each
+ * of its dates.  lunar_segments_bucket() then finds where each segment
+ * begins in a sorted array of timestamps, a binary search for each
+ * segment.  A solar day is in the lunar month of its lunar date; the
+ * hour 23 that begins the next lunar day is not taken into account.
+ */
+
+/* the julian day of January 1, 1970, the day of timestamp 0 */
+#define SEGMENT_UNIX_JULIAN		719163
+#define SEGMENT_DAY_SECONDS		86400
+
+/**
+ * lunar_segments_for_range:
+ * @start: the first day.
+ * @end: the last day.
+ *
+ * Cuts the solar days from @start to @end at the first day of each
+ * lunar month.  Days out of the supported years are left out.
+ *
+ * Return value: (transfer full) (element-type LunarSegment): a
+ * newly-allocated array of #LunarSegment, in order.
+ **/
+GArray* lunar_segments_for_range (const GDate *start, const GDate *end)
+{
+	LunarSegment segment;
+	GArray *array;
+	glong first, last, month_start, month_end;
+	gint ordinal, year, month;
+	gboolean isleap;
+
+	g_return_val_if_fail(g_date_valid(start), NULL);
+	g_return_val_if_fail(g_date_valid(end), NULL);
+
+	_lunar_tables_init();
+	array = g_array_new(FALSE, FALSE, sizeof(LunarSegment));
+	first = MAX((glong) g_date_get_julian(start) - LUNAR_DAYS_JULIAN, 0);
+	last = MIN((glong) g_date_get_julian(end) - LUNAR_DAYS_JULIAN, _lunar_year_start[NUM_OF_YEARS] - 1);
+	if (first > last)
+		return array;
+
+	for (ordinal = _lunar_month_find(first); _lunar_month_start[ordinal] <= last; ordinal++)
+	{
+		month_start = MAX(_lunar_month_start[ordinal], first);
+		month_end = MIN(_lunar_month_start[ordinal + 1] - 1, last);
+		_lunar_month_from_ordinal(ordinal, &year, &month, &isleap);
+		segment.julian = month_start + LUNAR_DAYS_JULIAN;
+		segment.n_days = month_end - month_start + 1;
+		segment.lunar_year = year;
+		segment.lunar_month = month;
+		segment.lunar_isleap = isleap;
+		g_array_append_val(array, segment);
+	}
+	return array;
+}
+
+/* The first of the sorted @timestamps not before @bound, or @n. */
+static gsize _segment_search (const gint64 *timestamps, gsize low, gsize n, gint64 bound)
+{
+	gsize mid;
+
+	while (low < n)
+	{
+		mid = low + (n - low) / 2;
+		if (timestamps[mid] < bound)
+			low = mid + 1;
+		else
+			n = mid;
+	}
+	return low;
+}
+
+/**
+ * lunar_segments_bucket:
+ * @segments: (array length=n_segments): segments in order, from
+ * lunar_segments_for_range().
+ * @n_segments: the number of segments.
+ * @timestamps: (array length=n_timestamps): sorted times, in seconds
+ * since January 1, 1970 UTC.
+ * @n_timestamps: the number of times.
+ * @utc_offset: the seconds the local time is ahead of UTC, which the
+ * solar days of @segments are in.
+ * @offsets: (out caller-allocates): return location for @n_segments + 1
+ * indexes into @timestamps.
+ *
+ * Finds the times that fall in each segment: those of segment i are
+ * @timestamps[@offsets[i]] up to but not including
+ * @timestamps[@offsets[i + 1]].  The times before the first segment are
+ * those before @offsets[0], and if the segments are of consecutive days,
+ * the times after the last one are those from @offsets[@n_segments] on.
+ **/
+void lunar_segments_bucket (const LunarSegment *segments, guint n_segments,
+		const gint64 *timestamps, gsize n_timestamps, gint utc_offset, gsize *offsets)
+{
+	const LunarSegment *segment;
+	gint64 bound;
+	gsize low = 0;
+	guint i;
+
+	g_return_if_fail(n_segments == 0 || segments != NULL);
+	g_return_if_fail(n_timestamps == 0 || timestamps != NULL);
+	g_return_if_fail(offsets != NULL);
+
+	offsets[0] = 0;
+	for (i = 0; i <= n_segments && n_segments > 0; i++)
+	{
+		/* the end of a segment is where the next one begins */
+		segment = &segments[MIN(i, n_segments - 1)];
+		bound = ((gint64) segment->julian + (i == n_segments ? segment->n_days : 0)
+				- SEGMENT_UNIX_JULIAN) * SEGMENT_DAY_SECONDS - utc_offset;
+		low = offsets[i] = _segment_search(timestamps, low, n_timestamps, bound);
+	}
+}
+
+/*
+vi:ts=4:wrap:ai:
+*/
@@ -0,0 +1,64 @@
+/* vi: set sw=4 ts=4: */
+/*
+ * lunar-segment.h
+ *
+ * This file is part of liblunar.
+ *
+ * Copyright (C) 2007-2011 yetist <yetist@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ * */
+
+#ifndef __LUNAR_SEGMENT_H__
+#define __LUNAR_SEGMENT_H__  1
+
+#include	<glib-object.h>
+
+G_BEGIN_DECLS
+
+typedef struct _LunarSegment			  LunarSegment;
+
+/**
+ * LunarSegment:
+ * @julian: the first solar day, as returned by g_date_get_julian().
+ * @n_days: the number of days.
+ * @lunar_year: the lunar year.
+ * @lunar_month: the lunar month, from 1 to 12.
+ * @lunar_isleap: whether @lunar_month is a leap month.
+ *
+ * The solar days of a range that are in one lunar month.
+ */
+struct _LunarSegment
+{
+	guint32		julian;
+	guint16		n_days;
+	guint16		lunar_year;
+	guint8		lunar_month;
+	guint8		lunar_isleap;
+};
+
+GArray*		lunar_segments_for_range	  (const GDate *start,
+												const GDate *end);
+void		lunar_segments_bucket		  (const LunarSegment *segments,
+												guint n_segments,
+												const gint64 *timestamps,
+												gsize n_timestamps,
+												gint utc_offset,
+												gsize *offsets);
+
+G_END_DECLS
+
+#endif /*__LUNAR_SEGMENT_H__ */
@@ -0,0 +1,282 @@
+/* vi: set sw=4 ts=4: */
+/*
+ * lunar-workday.c
+ *
+ * This file is part of liblunar.
+ *
+ * Copyright (C) 2007-2011 yetist <yetist@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ * */
+
+#if HAVE_CONFIG_H
+	#include <config.h>
+#endif
+#include <string.h>
+#include <lunar-date/lunar-workday.h>
+#include "lunar-holiday-private.h"
+
+/**
+ * SECTION:lunar-workday
+ * @Short_description: Workdays and business day arithmetic
+ * @Title: Workdays
+ *
+ * The workdays are Monday to Friday, moved by the official holiday
+ * schedule of the locale, for zh_CN the days off and the weekend days
+ * worked instead.  The user's <filename>liblunar/workday.dat</filename>
+ * in g_get_user_config_dir() overrides single days of it, or adds
+ * years:
+ *
+ * |[
+ * [2026]
+ * OFF=0101;0214-0222
+ * WORK=0215;0228
+ * ]|
+ *
+ * Each year is a bitset of its days, so counting the workdays of a
+ * span costs a few population counts per year.
+ */
+
+static inline gint _workday_popcount (guint64 bits)
+{
+#if defined(__GNUC__)
+	return __builtin_popcountll(bits);
+#else
+	bits = bits - ((bits >> 1) & G_GUINT64_CONSTANT(0x5555555555555555));
+	bits = (bits & G_GUINT64_CONSTANT(0x3333333333333333)) + ((bits >> 2) & G_GUINT64_CONSTANT(0x3333333333333333));
+	bits = (bits + (bits >> 4)) & G_GUINT64_CONSTANT(0x0f0f0f0f0f0f0f0f);
+	return (bits * G_GUINT64_CONSTANT(0x0101010101010101)) >> 56;
+#endif
+}
+
+/* The position of the @nth lowest bit set in @bits, @nth from 1. */
+static gint _workday_select (guint64 bits, gint nth)
+{
+	while (--nth > 0)
+		bits &= bits - 1;
+	return _workday_popcount((bits & -bits) - 1);
+}
+
+/* The bits of @first to @last, from 0 to 63, in a word. */
+static guint64 _workday_mask (gint first, gint last)
+{
+	guint64 mask = ~G_GUINT64_CONSTANT(0) << first;
+
+	if (last < 63)
+		mask &= (G_GUINT64_CONSTANT(2) << last) - 1;
+	return mask;
+}
+
+static gint _workday_year_days (gint year)
+{
+	return g_date_is_leap_year(year) ? 366 : 365;
+}
+
+/* Fills @days with the workdays of @year. */
+static void _workday_year (LunarHolidayDb *db, gint year, guint64 *days)
+{
+	LunarWorkdayYear *table;
+
+	table = g_hash_table_lookup(db->workdays, GINT_TO_POINTER(year));
+	if (table != NULL)
+		memcpy(days, table->days, sizeof(table->days));
+	else
+		_lunar_workday_weekdays(year, days);
+}
+
+/* The workdays from day @first to day @last of a year, both included. */
+static gint _workday_count (const guint64 *days, gint first, gint last)
+{
+	gint count = 0;
+	gint w;
+
+	if (first > last)
+		return 0;
+	for (w = first / 64; w <= last / 64; w++)
+		count += _workday_popcount(days[w] & _workday_mask(w == first / 64 ? first % 64 : 0,
+					w == last / 64 ? last % 64 : 63));
+	return count;
+}
+
+/*
+ * The workdays from day @first of @start_year to day @last of
+ * @end_year, both included.  The days count from 0, @first may be the
+ * day after the year and @last the day before it.
+ */
+static gint _workday_between (LunarHolidayDb *db, gint start_year, gint first, gint end_year, gint last)
+{
+	guint64 days[LUNAR_WORKDAY_WORDS];
+	gint year, count = 0;
+
+	for (year = start_year; year <= end_year; year++)
+	{
+		_workday_year(db, year, days);
+		count += _workday_count(days, year == start_year ? first : 0,
+				year == end_year ? last : _workday_year_days(year) - 1);
+	}
+	return count;
+}
+
+/*
+ * Moves @date to the @n_days-th workday after it, or before it if
+ * @n_days is negative.  Returns FALSE if there is none in the years of
+ * a GDate.
+ */
+static gboolean _workday_add (LunarHolidayDb *db, GDate *date, gint n_days)
+{
+	guint64 days[LUNAR_WORKDAY_WORDS];
+	gint year, day, w, count;
+	guint64 bits;
+
+	year = g_date_get_year(date);
+	day = g_date_get_day_of_year(date) - 1;
+	_workday_year(db, year, days);
+	if (n_days > 0)
+	{
+		for (day++; ; day = 0)
+		{
+			for (w = day / 64; w < LUNAR_WORKDAY_WORDS; w++)
+			{
+				bits = days[w] & _workday_mask(w == day / 64 ? day % 64 : 0, 63);
+				count = _workday_popcount(bits);
+				if (count >= n_days)
+				{
+					day = w * 64 + _workday_select(bits, n_days);
+					goto found;
+				}
+				n_days -= count;
+			}
+			if (year == G_MAXUINT16)
+				return FALSE;
+			_workday_year(db, ++year, days);
+		}
+	}
+	else if (n_days < 0)
+	{
+		n_days = -n_days;
+		for (day--; ; day = _workday_year_days(year) - 1)
+		{
+			for (w = day / 64; day >= 0 && w >= 0; w--)
+			{
+				bits = days[w] & _workday_mask(0, w == day / 64 ? day % 64 : 63);
+				count = _workday_popcount(bits);
+				if (count >= n_days)
+				{
+					day = w * 64 + _workday_select(bits, count - n_days + 1);
+					goto found;
+				}
+				n_days -= count;
+			}
+			if (year == 1)
+				return FALSE;
+			_workday_year(db, --year, days);
+		}
+	}
+	return TRUE;
+
+found:
+	g_date_set_dmy(date, 1, G_DATE_JANUARY, year);
+	g_date_add_days(date, day);
+	return TRUE;
+}
+
+/**
+ * lunar_is_workday:
+ * @date: a valid #GDate.
+ *
+ * Checks whether @date is a workday in the current locale.
+ *
+ * Return value: %TRUE if @date is a workday.
+ **/
+gboolean lunar_is_workday (const GDate *date)
+{
+	LunarHolidaySet *set;
+	guint64 days[LUNAR_WORKDAY_WORDS];
+	gint ticket, day;
+
+	g_return_val_if_fail(g_date_valid(date), FALSE);
+
+	set = _lunar_holiday_set_peek();
+	_workday_year(_lunar_holiday_set_acquire(set, &ticket), g_date_get_year(date), days);
+	_lunar_holiday_set_release(set, ticket);
+
+	day = g_date_get_day_of_year(date) - 1;
+	return (days[day / 64] >> (day % 64)) & 1;
+}
+
+/**
+ * lunar_add_business_days:
+ * @date: a valid #GDate to modify.
+ * @n_days: the number of workdays to move by.
+ *
+ * Moves @date to the @n_days-th workday after it, or before it if
+ * @n_days is negative.  @date itself does not need to be a workday, it
+ * is not counted.  If the result is out of the years a #GDate can
+ * hold, @date is left invalid.
+ **/
+void lunar_add_business_days (GDate *date, gint n_days)
+{
+	LunarHolidaySet *set;
+	gboolean ret;
+	gint ticket;
+
+	g_return_if_fail(g_date_valid(date));
+
+	set = _lunar_holiday_set_peek();
+	ret = _workday_add(_lunar_holiday_set_acquire(set, &ticket), date, n_days);
+	_lunar_holiday_set_release(set, ticket);
+	if (!ret)
+		g_date_clear(date, 1);
+}
+
+/**
+ * lunar_business_days_between:
+ * @start: a valid #GDate.
+ * @end: a valid #GDate.
+ *
+ * Counts the workdays from @start to @end, the way
+ * lunar_add_business_days() does: @start is not counted and @end is.
+ * If @end comes before @start, the count is negative, @end counted and
+ * @start not.  Moving @start by the count gives @end if it is a
+ * workday.
+ *
+ * Return value: the number of workdays, negative if @end comes before
+ * @start.
+ **/
+gint lunar_business_days_between (const GDate *start, const GDate *end)
+{
+	LunarHolidaySet *set;
+	LunarHolidayDb *db;
+	gint ticket, count;
+
+	g_return_val_if_fail(g_date_valid(start), 0);
+	g_return_val_if_fail(g_date_valid(end), 0);
+
+	set = _lunar_holiday_set_peek();
+	db = _lunar_holiday_set_acquire(set, &ticket);
+	if (g_date_compare(start, end) <= 0)
+		count = _workday_between(db, g_date_get_year(start), g_date_get_day_of_year(start),
+				g_date_get_year(end), g_date_get_day_of_year(end) - 1);
+	else
+		count = -_workday_between(db, g_date_get_year(end), g_date_get_day_of_year(end) - 1,
+				g_date_get_year(start), g_date_get_day_of_year(start) - 2);
+	_lunar_holiday_set_release(set, ticket);
+	return count;
+}
+
+/*
+vi:ts=4:wrap:ai:
+*/
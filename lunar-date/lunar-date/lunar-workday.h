@@ -0,0 +1,40 @@
+/* vi: set sw=4 ts=4: */
+/*
+ * lunar-workday.h
+ *
+ * This file is part of liblunar.
+ *
+ * Copyright (C) 2007-2011 yetist <yetist@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ * */
+
+#ifndef __LUNAR_WORKDAY_H__
+#define __LUNAR_WORKDAY_H__  1
+
+#include	<glib-object.h>
+
+G_BEGIN_DECLS
+
+gboolean	lunar_is_workday			  (const GDate *date);
+void		lunar_add_business_days		  (GDate *date,
+												gint n_days);
+gint		lunar_business_days_between	  (const GDate *start,
+												const GDate *end);
+
+G_END_DECLS
+
+#endif /*__LUNAR_WORKDAY_H__ */
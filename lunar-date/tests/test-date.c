@@ -23,7 +23,451 @@
  * */
 
 #include <lunar-date/lunar-date.h>
+#include <lunar-date/lunar-workday.h>
+#include <lunar-date/lunar-recurrence.h>
+#include <lunar-date/lunar-ical.h>
+#include <lunar-date/lunar-segment.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
+#include <string.h>
+
+static gint failures = 0;
+
+static void check (gboolean ok, const gchar *what)
+{
+	g_printf("check %s: %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok)
+		failures++;
+}
+
+static gboolean date_is (const GDate *date, GDateYear year, GDateMonth month, GDateDay day)
+{
+	return g_date_valid(date) && g_date_get_year(date) == year
+		&& g_date_get_month(date) == month && g_date_get_day(date) == day;
+}
+
+static gboolean solar_is (LunarDate *date, GDateYear year, GDateMonth month, GDateDay day)
+{
+	gchar *str, *expected;
+	gboolean ret;
+
+	str = lunar_date_strftime(date, "%(year)-%(month)-%(day)");
+	expected = g_strdup_printf("%u-%u-%u", year, month, day);
+	ret = g_strcmp0(str, expected) == 0;
+	g_free(expected);
+	g_free(str);
+	return ret;
+}
+
+/* Switches the message language, returns the one to give back to restore_language(). */
+static gchar* use_language (const gchar *language)
+{
+	gchar *old;
+
+	old = g_strdup(g_getenv("LANGUAGE"));
+	g_setenv("LANGUAGE", language, TRUE);
+	return old;
+}
+
+static void restore_language (gchar *language)
+{
+	if (language != NULL)
+		g_setenv("LANGUAGE", language, TRUE);
+	else
+		g_unsetenv("LANGUAGE");
+	g_free(language);
+}
+
+/* the zh_CN workday file: 2025-01-01 is off, Sunday 2025-01-26 is worked */
+static void check_workdays (void)
+{
+	gchar *language;
+	GDate date, end;
+
+	language = use_language("zh_CN");
+
+	g_date_set_dmy(&date, 31, 12, 2024);
+	lunar_add_business_days(&date, 1);
+	check(date_is(&date, 2025, 1, 2), "business day over the new year holiday");
+	lunar_add_business_days(&date, -1);
+	check(date_is(&date, 2024, 12, 31), "negative business days back over the year boundary");
+	lunar_add_business_days(&date, -2);
+	check(date_is(&date, 2024, 12, 27), "negative business days over a weekend");
+
+	g_date_set_dmy(&date, 24, 1, 2025);
+	lunar_add_business_days(&date, 1);
+	check(date_is(&date, 2025, 1, 26), "business day on a worked Sunday");
+	lunar_add_business_days(&date, 2);
+	check(date_is(&date, 2025, 2, 5), "business days over the spring festival");
+
+	/* @end counted and @start not, in both directions */
+	g_date_set_dmy(&date, 31, 12, 2024);
+	g_date_set_dmy(&end, 2, 1, 2025);
+	check(lunar_business_days_between(&date, &end) == 1
+			&& lunar_business_days_between(&end, &date) == -1, "business days between, over the year boundary");
+	g_date_set_dmy(&date, 28, 12, 2024);
+	g_date_set_dmy(&end, 30, 12, 2024);
+	check(lunar_business_days_between(&date, &end) == 1
+			&& lunar_business_days_between(&end, &date) == 0, "business days between, from a Saturday");
+
+	restore_language(language);
+}
+
+/* the user's holiday.dat of the checks, layered on the defaults */
+static const gchar user_holidays[] =
+	"[LUNAR]\n"
+	"# the default before it became the L12-1 rule\n"
+	"1230=除夕\n"
+	"[RULE]\n"
+	"L11-1=Month11End\n"
+	"W05-1=LastMonday\n"
+	"T23+15=AfterWinter\n"
+	"T00-10=BeforeXiaohan\n"
+	"D20240209=OneOff\n"
+	"L13-1=Bad\n"
+	"T05*3=Bad\n"
+	"X0101=Bad\n";
+
+static gboolean find_is (const gchar *name, GDateYear in_year, GDateYear year, GDateMonth month, GDateDay day)
+{
+	GDate date;
+
+	g_date_clear(&date, 1);
+	return lunar_holiday_find(name, in_year, &date) && date_is(&date, year, month, day);
+}
+
+/* The days named @name from @start to @end. */
+static guint count_named (const GDate *start, const GDate *end, const gchar *name)
+{
+	GArray *holidays;
+	gchar *str;
+	guint i, n = 0;
+
+	holidays = lunar_holidays_in_range(start, end);
+	for (i = 0; i < holidays->len; i++)
+	{
+		str = lunar_holiday_get_name(g_array_index(holidays, LunarHolidayOccurrence, i).id);
+		n += g_strcmp0(str, name) == 0;
+		g_free(str);
+	}
+	g_array_unref(holidays);
+	return n;
+}
+
+/* 2033 has a leap eleventh month, the years have no leap twelfth one */
+static void check_rules (void)
+{
+	gchar *language;
+	GDate start, end;
+
+	check(find_is("LastMonday", 2025, 2025, 5, 26), "W rule, last Monday of May");
+	check(find_is("OneOff", 2024, 2024, 2, 9) && !find_is("OneOff", 2025, 2025, 2, 9), "D rule, in its year only");
+	check(find_is("AfterWinter", 2025, 2025, 1, 5), "T rule, days after a term of the year before");
+	check(find_is("BeforeXiaohan", 2025, 2025, 12, 26), "T rule, days before a term of the year after");
+	check(lunar_holiday_lookup("Bad") == 0, "malformed rules skipped");
+
+	g_date_set_dmy(&start, 1, 11, 2033);
+	g_date_set_dmy(&end, 28, 2, 2034);
+	check(count_named(&start, &end, "Month11End") == 2
+			&& find_is("Month11End", 2033, 2033, 12, 21)
+			&& find_is("Month11End", 2034, 2034, 1, 19), "L rule, in the month and its leap month");
+
+	/* the defaults are compiled into the library, with the L12-1 rule */
+	language = use_language("zh_CN");
+	check(find_is("除夕", 2025, 2025, 1, 28), "compiled L12-1 rule, in a month of 29 days");
+	g_date_set_dmy(&start, 9, 2, 2024);
+	check(count_named(&start, &start, "除夕") == 1, "user [LUNAR] 1230 and the L12-1 rule on one day count once");
+	restore_language(language);
+}
+
+/* the first month of 2022 has 30 days, the second 29 */
+static void check_arithmetic (void)
+{
+	LunarDate *date;
+	GError *error = NULL;
+
+	date = lunar_date_new();
+	lunar_date_set_lunar_date(date, 2022, 1, 30, 0, FALSE, NULL);
+	lunar_date_add_months(date, 1, LUNAR_DATE_CLAMP_NONE, &error);
+	check(error != NULL && solar_is(date, 2022, 3, 2), "day 30 to a month of 29 days fails");
+	g_clear_error(&error);
+
+	lunar_date_add_months(date, 1, LUNAR_DATE_CLAMP_DAY, &error);
+	check(error == NULL && lunar_date_get_lunar_month(date) == 2
+			&& lunar_date_get_lunar_day(date) == 29, "day 30 clamped to day 29");
+
+	lunar_date_add_days(date, -29, NULL);
+	check(solar_is(date, 2022, 3, 2), "negative days");
+	lunar_date_free(date);
+}
+
+/* 2023 has a leap second month */
+static void check_search (void)
+{
+	LunarDate *date;
+
+	date = lunar_date_new();
+	lunar_date_set_solar_date(date, 2024, 1, 1, 0, NULL);
+	lunar_date_next_lunar(date, 1, 1, FALSE, LUNAR_DATE_CLAMP_NONE, NULL);
+	check(solar_is(date, 2024, 2, 10), "next lunar new year");
+	lunar_date_prev_lunar(date, 1, 1, FALSE, LUNAR_DATE_CLAMP_NONE, NULL);
+	check(solar_is(date, 2024, 2, 10), "previous lunar new year, on the day itself");
+	lunar_date_prev_lunar(date, 2, 15, TRUE, LUNAR_DATE_CLAMP_NONE, NULL);
+	check(solar_is(date, 2023, 4, 5), "previous leap month day");
+	lunar_date_free(date);
+}
+
+static void check_recurrence (void)
+{
+	LunarRecurrence rule = { LUNAR_RECURRENCE_YEARLY, 2, LUNAR_RECURRENCE_DAY(15), LUNAR_RECURRENCE_MONTHS_LEAP };
+	GArray *julians;
+	GDate start, end, date;
+
+	julians = g_array_new(FALSE, FALSE, sizeof(guint32));
+	g_date_set_dmy(&start, 1, 1, 2020);
+	g_date_set_dmy(&end, 31, 12, 2025);
+
+	lunar_recurrence_expand(&rule, &start, &end, julians);
+	g_date_set_julian(&date, julians->len == 1 ? g_array_index(julians, guint32, 0) : 1);
+	check(julians->len == 1 && date_is(&date, 2023, 4, 5), "leap month recurrence");
+
+	g_array_set_size(julians, 0);
+	rule.clamp = LUNAR_DATE_CLAMP_LEAP;
+	check(lunar_recurrence_expand(&rule, &start, &end, julians) == 6, "leap month recurrence, clamped");
+
+	g_array_set_size(julians, 0);
+	rule.months = LUNAR_RECURRENCE_MONTHS_ALL;
+	check(lunar_recurrence_expand(&rule, &start, &end, julians) == 7, "recurrence in both second months");
+	g_array_unref(julians);
+}
+
+/* the batch renders like lunar_date_strftime(), sized by a first pass */
+static void check_strftime_batch (void)
+{
+	const gchar *format = "%(year)-%(month)-%(day) %(ri)";
+	LunarDate *date;
+	GDate dates[3];
+	GError *error = NULL;
+	guint32 offsets[4], range_offsets[4];
+	gchar *buffer, *range, *str;
+	gsize len, n;
+	gboolean same = TRUE;
+	guint i;
+
+	date = lunar_date_new();
+	for (i = 0; i < 3; i++)
+		g_date_set_dmy(&dates[i], 9 + i, 2, 2024);
+
+	len = lunar_date_strftime_batch(date, dates, 3, 0, format, NULL, 0, offsets, NULL);
+	check(len > 0 && offsets[0] == 0 && offsets[3] == len, "batch sizing pass with no buffer");
+
+	/* one byte more, which must stay as it was */
+	buffer = g_malloc(len + 1);
+	buffer[len] = '#';
+	n = lunar_date_strftime_batch(date, dates, 3, 0, format, buffer, len, offsets, NULL);
+	for (i = 0; i < 3; i++)
+	{
+		lunar_date_set_solar_date(date, 2024, 2, 9 + i, 0, NULL);
+		str = lunar_date_strftime(date, format);
+		same = same && strlen(str) == offsets[i + 1] - offsets[i]
+			&& memcmp(buffer + offsets[i], str, strlen(str)) == 0;
+		g_free(str);
+	}
+	check(n == len && same && buffer[len] == '#', "batch strings as lunar_date_strftime()");
+
+	range = g_malloc(len);
+	n = lunar_date_strftime_range(date, &dates[0], 3, 0, format, range, len, range_offsets, NULL);
+	check(n == len && memcmp(range, buffer, len) == 0
+			&& memcmp(range_offsets, offsets, sizeof(offsets)) == 0, "range as the batch of its days");
+
+	/* a short buffer: nothing past it, the offsets still complete */
+	memset(range, '#', len);
+	n = lunar_date_strftime_range(date, &dates[0], 3, 0, format, range, 4, range_offsets, NULL);
+	check(n == len && range[4] == '#' && range_offsets[3] == len, "batch into a short buffer");
+
+	g_date_clear(&dates[1], 1);
+	n = lunar_date_strftime_batch(date, dates, 3, 0, format, buffer, len, offsets, &error);
+	check(n == 0 && error != NULL, "batch with an invalid date");
+	g_clear_error(&error);
+
+	g_free(range);
+	g_free(buffer);
+	lunar_date_free(date);
+}
+
+/* The seconds since the epoch of a local time @utc_offset ahead of UTC. */
+static gint64 local_time (gint utc_offset, gint year, gint month, gint day, gint hour, gint minute)
+{
+	GDateTime *time;
+	gint64 seconds;
+
+	time = g_date_time_new_utc(year, month, day, hour, minute, 0);
+	seconds = g_date_time_to_unix(time) - utc_offset;
+	g_date_time_unref(time);
+	return seconds;
+}
+
+/* the lunar new year of 2024 is February 10, the first month has 29 days */
+static void check_segments (void)
+{
+	const gint beijing = 8 * 3600;
+	LunarSegment *segment;
+	GArray *segments;
+	GDate start, end;
+	gint64 times[6];
+	gsize offsets[4];
+
+	g_date_set_dmy(&start, 1, 2, 2024);
+	g_date_set_dmy(&end, 31, 3, 2024);
+	segments = lunar_segments_for_range(&start, &end);
+	segment = (LunarSegment *) segments->data;
+	check(segments->len == 3
+			&& segment[0].julian == g_date_get_julian(&start) && segment[0].n_days == 9
+			&& segment[0].lunar_year == 2023 && segment[0].lunar_month == 12
+			&& segment[1].lunar_year == 2024 && segment[1].lunar_month == 1 && segment[1].n_days == 29
+			&& segment[2].lunar_month == 2 && segment[2].n_days == 22, "segments of a range");
+
+	times[0] = local_time(beijing, 2024, 1, 31, 23, 0);		/* before the first segment */
+	times[1] = local_time(beijing, 2024, 2, 9, 23, 30);
+	times[2] = local_time(beijing, 2024, 2, 10, 0, 0);
+	times[3] = local_time(0, 2024, 2, 9, 17, 0);			/* still February 9 in UTC */
+	times[4] = local_time(beijing, 2024, 3, 15, 12, 0);
+	times[5] = local_time(beijing, 2024, 4, 1, 0, 0);		/* after the last segment */
+	lunar_segments_bucket(segment, segments->len, times, G_N_ELEMENTS(times), beijing, offsets);
+	check(offsets[0] == 1 && offsets[1] == 2 && offsets[2] == 4 && offsets[3] == 5, "times bucketed by local day");
+
+	lunar_segments_bucket(segment, segments->len, times, G_N_ELEMENTS(times), 0, offsets);
+	/* the Beijing times of February 10 and of April 1 are not those days in UTC */
+	check(offsets[0] == 1 && offsets[1] == 4 && offsets[2] == 4 && offsets[3] == 6, "times bucketed by UTC day");
+	g_array_unref(segments);
+}
+
+/* The calendar of @rule in @year, as a string. */
+static gchar* write_ical (const LunarRecurrence *rule, const gchar *summary, GDateYear year)
+{
+	GOutputStream *stream;
+	GDate start, end;
+	gchar *str = NULL;
+
+	stream = g_memory_output_stream_new_resizable();
+	g_date_set_dmy(&start, 1, 1, year);
+	g_date_set_dmy(&end, 31, 12, year);
+	if (lunar_ical_write_recurrence(stream, rule, summary, &start, &end, NULL, NULL)
+			&& g_output_stream_close(stream, NULL, NULL))
+		str = g_strndup(g_memory_output_stream_get_data(G_MEMORY_OUTPUT_STREAM(stream)),
+				g_memory_output_stream_get_data_size(G_MEMORY_OUTPUT_STREAM(stream)));
+	g_object_unref(stream);
+	return str;
+}
+
+/* The unfolded value of the first @name line of @ical, NULL if the lines are not well-formed. */
+static gchar* ical_value (const gchar *ical, const gchar *name)
+{
+	GString *unfolded;
+	gchar **lines, *value = NULL;
+	gint i;
+
+	if (ical == NULL || !g_str_has_suffix(ical, "\r\n"))
+		return NULL;
+	unfolded = g_string_new(NULL);
+	lines = g_strsplit(ical, "\r\n", -1);
+	for (i = 0; lines[i] != NULL && lines[i + 1] != NULL; i++)
+	{
+		/* no bare CR or LF, at most 75 octets, never a broken character */
+		if (strpbrk(lines[i], "\r\n") != NULL || strlen(lines[i]) > 75 || !g_utf8_validate(lines[i], -1, NULL))
+			break;
+		if (lines[i][0] == ' ')
+			g_string_append(unfolded, lines[i] + 1);
+		else
+			g_string_append_printf(unfolded, "\n%s", lines[i]);
+	}
+	if (lines[i + 1] == NULL)
+	{
+		gchar *key = g_strdup_printf("\n%s:", name);
+		gchar *p = strstr(unfolded->str, key);
+
+		if (p != NULL)
+			value = g_strndup(p + strlen(key), strcspn(p + strlen(key), "\n"));
+		g_free(key);
+	}
+	g_strfreev(lines);
+	g_string_free(unfolded, TRUE);
+	return value;
+}
+
+/* the summary is escaped then folded, the UID follows the rule */
+static void check_ical (void)
+{
+	LunarRecurrence rule = { LUNAR_RECURRENCE_YEARLY, 8, LUNAR_RECURRENCE_DAY(15), LUNAR_RECURRENCE_MONTHS_ALL };
+	const gchar *summary = "中秋;赏月,家宴\\备注\r\n第二行\r第三行\n月饼月饼月饼月饼月饼月饼月饼月饼月饼月饼";
+	const gchar *escaped = "中秋\\;赏月\\,家宴\\\\备注\\n第二行\\n第三行\\n月饼月饼月饼月饼月饼月饼月饼月饼月饼月饼";
+	gchar *ical, *value, *uid, *other;
+
+	ical = write_ical(&rule, summary, 2025);
+	value = ical_value(ical, "SUMMARY");
+	check(g_strcmp0(value, escaped) == 0, "iCalendar lines folded and escaped");
+	g_free(value);
+	uid = ical_value(ical, "UID");
+	value = ical_value(ical, "DTSTART;VALUE=DATE");
+	check(g_strcmp0(value, "20251006") == 0, "iCalendar recurrence day");
+	g_free(value);
+	g_free(ical);
+
+	rule.days = LUNAR_RECURRENCE_DAY(16);
+	ical = write_ical(&rule, summary, 2025);
+	other = ical_value(ical, "UID");
+	check(uid != NULL && other != NULL && strcmp(uid, other) != 0, "iCalendar UID of another rule of the same summary");
+	g_free(other);
+	g_free(uid);
+	g_free(ical);
+}
+
+/* 23 o'clock already belongs to the next lunar day */
+static void check_pack (void)
+{
+	LunarDate *date;
+	guint32 late, midnight;
+
+	date = lunar_date_new();
+	lunar_date_set_solar_date(date, 2024, 2, 9, 23, NULL);
+	late = lunar_date_pack(date, TRUE);
+	lunar_date_set_solar_date(date, 2024, 2, 10, 0, NULL);
+	midnight = lunar_date_pack(date, TRUE);
+	check(late < midnight && late >> 5 == midnight >> 5
+			&& midnight >> 5 == LUNAR_DATE_PACK(2024, 1, FALSE, 1) >> 5, "23:00 packs before 00:00 of the same lunar day");
+	lunar_date_free(date);
+}
+
+static gint run_checks (void)
+{
+	gchar *config, *dir, *file;
+
+	/* before the first holiday lookup, which reads the user's files */
+	config = g_dir_make_tmp("test-date-XXXXXX", NULL);
+	dir = g_build_filename(config, "liblunar", NULL);
+	file = g_build_filename(dir, "holiday.dat", NULL);
+	g_mkdir(dir, 0700);
+	g_file_set_contents(file, user_holidays, -1, NULL);
+	g_setenv("XDG_CONFIG_HOME", config, TRUE);
+
+	check_workdays();
+	check_arithmetic();
+	check_search();
+	check_recurrence();
+	check_pack();
+	check_rules();
+	check_strftime_batch();
+	check_segments();
+	check_ical();
+
+	g_unlink(file);
+	g_rmdir(dir);
+	g_rmdir(config);
+	g_free(file);
+	g_free(dir);
+	g_free(config);
+	return failures;
+}
 
 static void display (LunarDate *date)
 {
@@ -135,6 +579,9 @@ int main (int argc, char* argv[])
 	else 
 	{
 		int i = 10;
+
+		if (run_checks() > 0)
+			return 1;
 		while (i-- >=0)
 		{
 			g_printf("--------------------------------------\n");
@@ -0,0 +1,230 @@
+/* vi: set sw=4 ts=4: */
+/*
+ * test-holiday-db.c
+ *
+ * This file is part of liblunar.
+ *
+ * Copyright (C) 2007 - yetist <yetist@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ * */
+
+/*
+ * The holiday tables, built with lunar-holiday-private.c the way
+ * lunar-holiday-compile is, as the library does not export them: a
+ * holiday.dat written in the compiled format loads back the same, and
+ * the 16 bit name slots refuse a name too many.
+ */
+
+#include <string.h>
+#include <glib/gprintf.h>
+#include <glib/gstdio.h>
+#include "lunar-holiday-private.h"
+
+static gint failures = 0;
+
+static void check (gboolean ok, const gchar *what)
+{
+	g_printf("check %s: %s\n", what, ok ? "ok" : "FAILED");
+	if (!ok)
+		failures++;
+}
+
+/* every kind of entry, and one removing a holiday of a lower layer */
+static const gchar holidays[] =
+	"[SOLAR]\n"
+	"0101=New Year\n"
+	"1231=\n"
+	"[LUNAR]\n"
+	"0101=Spring Festival\n"
+	"0815=Mid-Autumn\n"
+	"[WEEK]\n"
+	"0520=Mother's Day\n"
+	"[RULE]\n"
+	"L12-1=New Year's Eve\n"
+	"W05-1=Last Monday\n"
+	"T06-3=Before a term\n"
+	"D20240209=Once\n";
+
+static LunarHolidayDb* load (const gchar *data, gsize len)
+{
+	LunarHolidayDb *db;
+	GBytes *bytes;
+
+	db = _lunar_holiday_db_new();
+	bytes = g_bytes_new(data, len);
+	if (!_lunar_holiday_db_load_bytes(db, bytes, NULL))
+	{
+		_lunar_holiday_db_free(db);
+		db = NULL;
+	}
+	g_bytes_unref(bytes);
+	return db;
+}
+
+/* Whether the slots and the rules of @a and @b hold the same names. */
+static gboolean db_equal (LunarHolidayDb *a, LunarHolidayDb *b)
+{
+	LunarHolidayRule *rule, *other;
+	gint m, d, n, w;
+	guint i, j;
+
+	for (m = 1; m <= 12; m++)
+	{
+		for (d = 1; d <= 31; d++)
+			if ((a->solar[m][d] == LUNAR_HOLIDAY_DB_REMOVED) != (b->solar[m][d] == LUNAR_HOLIDAY_DB_REMOVED)
+					|| g_strcmp0(_lunar_holiday_db_solar(a, m, d), _lunar_holiday_db_solar(b, m, d)) != 0)
+				return FALSE;
+		for (d = 1; d <= 30; d++)
+			if (g_strcmp0(_lunar_holiday_db_lunar(a, m, d), _lunar_holiday_db_lunar(b, m, d)) != 0)
+				return FALSE;
+		for (n = 1; n <= 5; n++)
+			for (w = 0; w <= 6; w++)
+				if (g_strcmp0(_lunar_holiday_db_week(a, m, n, w), _lunar_holiday_db_week(b, m, n, w)) != 0)
+					return FALSE;
+	}
+
+	if (a->rules->len != b->rules->len)
+		return FALSE;
+	for (i = 0; i < a->rules->len; i++)
+	{
+		rule = &g_array_index(a->rules, LunarHolidayRule, i);
+		for (j = 0; j < b->rules->len; j++)
+		{
+			other = &g_array_index(b->rules, LunarHolidayRule, j);
+			if (other->id == rule->id)
+				break;
+		}
+		if (j == b->rules->len
+				|| g_strcmp0(_lunar_holiday_db_name(a, rule->name), _lunar_holiday_db_name(b, other->name)) != 0)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static void check_round_trip (const gchar *dir)
+{
+	LunarHolidayDb *db, *compiled;
+	gchar *file, *again, *data, *data2;
+	gsize len, len2;
+
+	file = g_build_filename(dir, "holiday.bin", NULL);
+	again = g_build_filename(dir, "holiday2.bin", NULL);
+	db = load(holidays, strlen(holidays));
+	check(db != NULL && db->rules->len == 4, "text holidays loaded");
+
+	_lunar_holiday_db_write(db, file, NULL);
+	g_file_get_contents(file, &data, &len, NULL);
+	compiled = load(data, len);
+	check(compiled != NULL && db_equal(db, compiled), "compiled holidays load back the same");
+	check(compiled != NULL && compiled->solar[12][31] == LUNAR_HOLIDAY_DB_REMOVED, "removal kept by the compiled format");
+
+	/* written again from the compiled tables, byte for byte */
+	_lunar_holiday_db_write(compiled, again, NULL);
+	g_file_get_contents(again, &data2, &len2, NULL);
+	check(len == len2 && memcmp(data, data2, len) == 0, "compiled holidays written again the same");
+
+	g_unlink(file);
+	g_unlink(again);
+	g_free(data);
+	g_free(data2);
+	g_free(file);
+	g_free(again);
+	_lunar_holiday_db_free(compiled);
+	_lunar_holiday_db_free(db);
+}
+
+/* every solar, lunar and week slot, 1152 names a layer */
+static GString* all_slots (void)
+{
+	GString *str;
+	gint m, d, n, w;
+
+	str = g_string_new("[SOLAR]\n");
+	for (m = 1; m <= 12; m++)
+		for (d = 1; d <= 31; d++)
+			g_string_append_printf(str, "%02d%02d=S%d\n", m, d, m * 100 + d);
+	g_string_append(str, "[LUNAR]\n");
+	for (m = 1; m <= 12; m++)
+		for (d = 1; d <= 30; d++)
+			g_string_append_printf(str, "%02d%02d=L%d\n", m, d, m * 100 + d);
+	g_string_append(str, "[WEEK]\n");
+	for (m = 1; m <= 12; m++)
+		for (n = 1; n <= 5; n++)
+			for (w = 0; w <= 6; w++)
+				g_string_append_printf(str, "%02d%d%d=W%d\n", m, n, w, m * 100 + n * 10 + w);
+	return str;
+}
+
+static void check_names_cap (const gchar *dir)
+{
+	LunarHolidayDb *db, *full;
+	GString *str;
+	GBytes *bytes;
+	GError *error = NULL;
+	gchar *file, *data;
+	gsize len;
+	gint layers;
+
+	/* layers of the same entries, each adds its names */
+	str = all_slots();
+	bytes = g_bytes_new(str->str, str->len);
+	db = _lunar_holiday_db_new();
+	for (layers = 0; layers < 100 && _lunar_holiday_db_load_bytes(db, bytes, &error); layers++)
+		;
+	check(error != NULL && db->names->len == G_MAXUINT16 + 1 && layers == (G_MAXUINT16 - 1) / 1152,
+			"the 65534th name is the last one");
+	g_clear_error(&error);
+	g_bytes_unref(bytes);
+	_lunar_holiday_db_free(db);
+
+	/* a compiled layer that does not fit leaves the tables as they were */
+	file = g_build_filename(dir, "all.bin", NULL);
+	full = load(str->str, str->len);
+	_lunar_holiday_db_write(full, file, NULL);
+	g_file_get_contents(file, &data, &len, NULL);
+	bytes = g_bytes_new_take(data, len);
+	db = _lunar_holiday_db_new();
+	while (db->names->len < G_MAXUINT16 + 1 - 1000)
+		g_ptr_array_add(db->names, "filler");
+	check(!_lunar_holiday_db_load_bytes(db, bytes, &error) && error != NULL
+			&& db->solar[1][1] == 0 && db->names->len == G_MAXUINT16 + 1 - 1000,
+			"compiled layer over the name cap refused whole");
+	g_clear_error(&error);
+
+	g_unlink(file);
+	g_bytes_unref(bytes);
+	g_free(file);
+	g_string_free(str, TRUE);
+	_lunar_holiday_db_free(full);
+	_lunar_holiday_db_free(db);
+}
+
+int main (int argc, char **argv)
+{
+	gchar *dir;
+
+	dir = g_dir_make_tmp("test-holiday-db-XXXXXX", NULL);
+	check_round_trip(dir);
+	check_names_cap(dir);
+	g_rmdir(dir);
+	g_free(dir);
+	return failures > 0;
+}
+
+/*
+vi:ts=4:wrap:ai:
+*/
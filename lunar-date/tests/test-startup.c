@@ -0,0 +1,105 @@
+/* vi: set sw=4 ts=4: */
+/*
+ * test-startup.c
+ *
+ * This file is part of liblunar.
+ *
+ * Copyright (C) 2007 - yetist <yetist@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ * */
+
+/*
+ * Startup latency: the time to the first conversion, which must not
+ * touch the holiday files, then the time to the first holiday lookup,
+ * which loads them.
+ *
+ * The user's holiday.dat is replaced by a broken one, which the library
+ * reports with a g_critical() when it loads it: there must be none after
+ * the conversion, and one after the lookup.
+ */
+
+#include <lunar-date/lunar-date.h>
+#include <glib/gprintf.h>
+#include <glib/gstdio.h>
+
+#define N_DATES	1000
+
+static gint n_criticals = 0;
+
+static void count_criticals (const gchar *domain, GLogLevelFlags level, const gchar *message, gpointer data)
+{
+	n_criticals++;
+}
+
+int main (int argc, char **argv)
+{
+	LunarDate *date;
+	gint64 start, first, holiday, many;
+	gchar *config, *dir, *file, *str;
+	gint i, loaded;
+
+	config = g_dir_make_tmp("test-startup-XXXXXX", NULL);
+	dir = g_build_filename(config, "liblunar", NULL);
+	file = g_build_filename(dir, "holiday.dat", NULL);
+	g_mkdir(dir, 0700);
+	g_file_set_contents(file, "[SOLAR\n", -1, NULL);
+	g_setenv("XDG_CONFIG_HOME", config, TRUE);
+	g_log_set_handler(NULL, G_LOG_LEVEL_CRITICAL, count_criticals, NULL);
+
+	start = g_get_monotonic_time();
+	date = lunar_date_new();
+	lunar_date_set_solar_date(date, 2010, 2, 14, 8, NULL);
+	str = lunar_date_strftime(date, "%(NIAN)年%(YUE)月%(RI)日");
+	first = g_get_monotonic_time();
+	g_free(str);
+	loaded = n_criticals;
+
+	str = lunar_date_get_jieri(date, " ");
+	holiday = g_get_monotonic_time();
+	g_free(str);
+	lunar_date_free(date);
+
+	g_unlink(file);
+	g_rmdir(dir);
+	g_rmdir(config);
+	g_free(file);
+	g_free(dir);
+	g_free(config);
+	if (loaded != 0 || n_criticals != 1)
+	{
+		g_printf("holiday files loaded by the first conversion: %s, by the first lookup: %s\n",
+				loaded != 0 ? "yes" : "no", n_criticals > loaded ? "yes" : "no");
+		return 1;
+	}
+
+	for (i = 0; i < N_DATES; i++)
+	{
+		date = lunar_date_new();
+		lunar_date_set_solar_date(date, 2010, 2, 14, 8, NULL);
+		lunar_date_free(date);
+	}
+	many = g_get_monotonic_time();
+
+	g_printf("first conversion:     %6" G_GINT64_FORMAT " us\n", first - start);
+	g_printf("first holiday lookup: %6" G_GINT64_FORMAT " us\n", holiday - first);
+	g_printf("new + convert:        %6.2f us\n", (gdouble) (many - holiday) / N_DATES);
+	return 0;
+}
+
+/*
+vi:ts=4:wrap:ai:
+*/
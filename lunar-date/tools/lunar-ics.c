@@ -0,0 +1,127 @@
+/* vi: set sw=4 ts=4: */
+/*
+ * lunar-ics.c
+ *
+ * This file is part of liblunar.
+ *
+ * Copyright (C) 2007-2011 yetist <yetist@gmail.com>.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ * */
+
+/*
+ * Writes the holidays and solar terms of a span of years as an
+ * iCalendar file:
+ *
+ *	 lunar-ics [--holidays] [--terms] START_YEAR [END_YEAR] FILE
+ */
+
+#include <locale.h>
+#include <lunar-date/lunar-date.h>
+#include <lunar-date/lunar-ical.h>
+#include <glib/gprintf.h>
+
+static gboolean holidays = FALSE;
+static gboolean terms = FALSE;
+
+static GOptionEntry entries[] =
+{
+	{ "holidays", 'H', 0, G_OPTION_ARG_NONE, &holidays, "Write the holidays", NULL },
+	{ "terms", 't', 0, G_OPTION_ARG_NONE, &terms, "Write the solar terms", NULL },
+	{ NULL }
+};
+
+/* Parses @arg into @year, a year a GDate can hold. */
+static gboolean parse_year (const gchar *arg, GDateYear *year)
+{
+	GError *error = NULL;
+	guint64 n;
+
+	if (!g_ascii_string_to_unsigned(arg, 10, 1, G_MAXUINT16, &n, &error))
+	{
+		g_fprintf(stderr, "%s: bad year: %s\n", g_get_prgname(), error->message);
+		g_error_free(error);
+		return FALSE;
+	}
+	*year = n;
+	return TRUE;
+}
+
+int main (int argc, char **argv)
+{
+	GOptionContext *context;
+	GFile *file;
+	GFileOutputStream *stream;
+	LunarIcalFlags flags;
+	GError *error = NULL;
+	GDateYear start_year, end_year;
+	gboolean ret;
+
+	setlocale (LC_ALL, "");
+	context = g_option_context_new("START_YEAR [END_YEAR] FILE");
+	g_option_context_set_summary(context, "Writes the holidays and the solar terms, "
+			"both unless one is asked for, as an iCalendar file.");
+	g_option_context_add_main_entries(context, entries, NULL);
+	if (!g_option_context_parse(context, &argc, &argv, &error))
+	{
+		g_fprintf(stderr, "%s: %s\n", g_get_prgname(), error->message);
+		g_error_free(error);
+		g_option_context_free(context);
+		return 1;
+	}
+	if (argc != 3 && argc != 4)
+	{
+		gchar *help = g_option_context_get_help(context, TRUE, NULL);
+		g_fprintf(stderr, "%s", help);
+		g_free(help);
+		g_option_context_free(context);
+		return 1;
+	}
+	g_option_context_free(context);
+
+	if (!parse_year(argv[1], &start_year))
+		return 1;
+	end_year = start_year;
+	if (argc == 4 && !parse_year(argv[2], &end_year))
+		return 1;
+	if (end_year < start_year)
+	{
+		g_fprintf(stderr, "%s: end year %s is before start year %s\n", g_get_prgname(), argv[2], argv[1]);
+		return 1;
+	}
+	flags = (holidays ? LUNAR_ICAL_HOLIDAYS : 0) | (terms ? LUNAR_ICAL_TERMS : 0);
+	if (flags == 0)
+		flags = LUNAR_ICAL_HOLIDAYS | LUNAR_ICAL_TERMS;
+
+	file = g_file_new_for_commandline_arg(argv[argc - 1]);
+	stream = g_file_replace(file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, &error);
+	ret = stream != NULL
+		&& lunar_ical_write(G_OUTPUT_STREAM(stream), start_year, end_year, flags, NULL, &error)
+		&& g_output_stream_close(G_OUTPUT_STREAM(stream), NULL, &error);
+	if (!ret)
+	{
+		g_fprintf(stderr, "%s: %s\n", g_get_prgname(), error->message);
+		g_error_free(error);
+	}
+	if (stream != NULL)
+		g_object_unref(stream);
+	g_object_unref(file);
+	return ret ? 0 : 1;
+}
+
+/*
+vi:ts=4:wrap:ai:
+*/